@@ -0,0 +1,132 @@
+// scheduling_policy.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares the scheduling policies, e.g. on Linux:
+//   g++ -std=c++17 -O2 -Isrc -D_TPLMGR_STATIC bench/scheduling_policy.cpp src/tplmgr/*.cpp -pthread
+//
+// Each scenario is run by a few producer threads that schedule tasks from outside the pool:
+//   uniform  - tiny tasks, measures the cost of scheduling
+//   skewed   - every 16th task is 64 times longer, measures the balance
+//   locality - each producer's tasks read the producer's own buffer, measures cache locality
+// The balance is shown as the most and the fewest tasks performed by one thread.
+
+#include <tplmgr/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr size_t _Threads         = 4;
+    constexpr size_t _Producers       = 3;
+    constexpr size_t _Tasks           = 30000; // per producer
+    constexpr size_t _Buffer_elements = 8192; // 64 KiB per producer
+
+    struct _Scenario {
+        const char* _Name;
+        ::tplmgr::thread::task _Task;
+        bool _Uses_buffers;
+    };
+
+    ::std::atomic<size_t> _Finished{0};
+
+    void _Spin(const uint32_t _Iterations) noexcept {
+        volatile uint32_t _Sink = 0;
+        for (uint32_t _Idx = 0; _Idx < _Iterations; ++_Idx) {
+            _Sink = _Sink + _Idx;
+        }
+    }
+
+    void _Uniform_task(void*) {
+        _Finished.fetch_add(1, ::std::memory_order_relaxed);
+    }
+
+    void _Skewed_task(void* const _Data) {
+        _Spin(reinterpret_cast<uintptr_t>(_Data) % 16 == 0 ? 64 * 256 : 256);
+        _Finished.fetch_add(1, ::std::memory_order_relaxed);
+    }
+
+    void _Locality_task(void* const _Data) {
+        const uint64_t* const _Buffer = static_cast<const uint64_t*>(_Data);
+        uint64_t _Sum                 = 0;
+        for (size_t _Idx = 0; _Idx < _Buffer_elements; ++_Idx) {
+            _Sum += _Buffer[_Idx];
+        }
+
+        if (_Sum == 1) { // never true, keeps the loop
+            ::std::puts("");
+        }
+
+        _Finished.fetch_add(1, ::std::memory_order_relaxed);
+    }
+
+    double _Run(const ::tplmgr::scheduling_policy _Policy, const _Scenario& _Test, uint64_t& _Most, uint64_t& _Fewest) {
+        ::tplmgr::thread_pool _Pool(_Threads, _Policy);
+        ::std::vector<::std::vector<uint64_t>> _Buffers(_Producers, ::std::vector<uint64_t>(_Buffer_elements, 2));
+        _Finished.store(0, ::std::memory_order_relaxed);
+        const auto _Start = ::std::chrono::steady_clock::now();
+        ::std::vector<::std::thread> _Workers;
+        for (size_t _Producer = 0; _Producer < _Producers; ++_Producer) {
+            _Workers.emplace_back([&, _Producer] {
+                for (size_t _Idx = 0; _Idx < _Tasks; ++_Idx) {
+                    void* const _Data = _Test._Uses_buffers ? static_cast<void*>(_Buffers[_Producer].data())
+                                                            : reinterpret_cast<void*>(_Idx);
+                    while (!_Pool.schedule_task(_Test._Task, _Data)) { // retry if an allocation fails
+                        ::std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for (::std::thread& _Worker : _Workers) {
+            _Worker.join();
+        }
+
+        _Pool.wait_idle();
+        const double _Elapsed =
+            ::std::chrono::duration<double, ::std::milli>(::std::chrono::steady_clock::now() - _Start).count();
+        ::tplmgr::thread_counters _Counters[_Threads] = {};
+        const size_t _Count = (::std::min)(_Pool.snapshot(_Counters, _Threads), _Threads);
+        _Most               = 0;
+        _Fewest             = UINT64_MAX;
+        for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+            _Most   = (::std::max)(_Most, _Counters[_Idx].executed_tasks);
+            _Fewest = (::std::min)(_Fewest, _Counters[_Idx].executed_tasks);
+        }
+
+        return _Elapsed;
+    }
+} // namespace
+
+int main() {
+    const _Scenario _Scenarios[] = {
+        {"uniform", &_Uniform_task, false}, {"skewed", &_Skewed_task, false}, {"locality", &_Locality_task, true}};
+    const struct {
+        const char* _Name;
+        ::tplmgr::scheduling_policy _Policy;
+    } _Policies[] = {{"idle_first", ::tplmgr::scheduling_policy::idle_first},
+        {"round_robin", ::tplmgr::scheduling_policy::round_robin},
+        {"power_of_two_choices", ::tplmgr::scheduling_policy::power_of_two_choices},
+        {"least_loaded", ::tplmgr::scheduling_policy::least_loaded},
+        {"sticky", ::tplmgr::scheduling_policy::sticky}};
+    ::std::printf("%zu threads, %zu producers, %zu tasks each, %u processors\n\n", _Threads, _Producers, _Tasks,
+        ::std::thread::hardware_concurrency());
+    ::std::printf("%-22s %-10s %10s %8s %8s\n", "policy", "scenario", "ms", "most", "fewest");
+    for (const auto& _Entry : _Policies) {
+        for (const _Scenario& _Test : _Scenarios) {
+            uint64_t _Most        = 0;
+            uint64_t _Fewest      = 0;
+            const double _Elapsed = _Run(_Entry._Policy, _Test, _Most, _Fewest);
+            ::std::printf("%-22s %-10s %10.1f %8llu %8llu\n", _Entry._Name, _Test._Name, _Elapsed,
+                static_cast<unsigned long long>(_Most), static_cast<unsigned long long>(_Fewest));
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -13,23 +13,333 @@ constexpr bool _Is_pow_of_2(const size_t _Val) noexcept {
     return _Val > 0 && (_Val & (_Val - 1)) == 0;
 }
 
+// FUNCTION _Allocate_from_heap
+static void* _Allocate_from_heap(const size_t _Size, const size_t _Align) noexcept {
+#ifdef __cpp_aligned_new
+    return ::operator new(_Size, align_val_t{_Align}, _STD nothrow);
+#else // ^^^ __cpp_aligned_new ^^^ / vvv !__cpp_aligned_new vvv
+    (void) _Align; // alignment not used
+    return ::operator new(_Size, _STD nothrow);
+#endif // __cpp_aligned_new
+}
+
+// FUNCTION _Deallocate_to_heap
+static void _Deallocate_to_heap(void* const _Ptr, const size_t _Size, const size_t _Align) noexcept {
+#ifdef __cpp_aligned_new
+    ::operator delete(_Ptr, _Size, align_val_t{_Align});
+#else // ^^^ __cpp_aligned_new ^^^ / vvv !__cpp_aligned_new vvv
+    (void) _Align; // alignment not used
+    ::operator delete(_Ptr, _Size);
+#endif // __cpp_aligned_new
+}
+
+// CLASS _Memory_usage
+class _Memory_usage { // global allocation statistics
+public:
+    static _Memory_usage& _Instance() noexcept {
+        static _Memory_usage _Usage;
+        return _Usage;
+    }
+
+    void _Add(const ptrdiff_t _Bytes) noexcept {
+        const ptrdiff_t _New_bytes = _Mybytes.fetch_add(_Bytes, _STD memory_order_relaxed) + _Bytes;
+        ptrdiff_t _Peak            = _Mypeak.load(_STD memory_order_relaxed);
+        while (_New_bytes > _Peak
+            && !_Mypeak.compare_exchange_weak(_Peak, _New_bytes, _STD memory_order_relaxed)) {}
+    }
+
+    void _Reserve(const size_t _Bytes) noexcept {
+        _Myreserved.fetch_add(_Bytes, _STD memory_order_relaxed);
+    }
+
+    allocator_statistics _Statistics() const noexcept {
+        // Note: Each thread reports its pool usage in batches, so _Mybytes may be temporarily
+        //       negative if a block has been deallocated by a thread that has not allocated it.
+        const ptrdiff_t _Bytes = _Mybytes.load(_STD memory_order_relaxed);
+        return allocator_statistics{_Bytes > 0 ? static_cast<size_t>(_Bytes) : 0,
+            static_cast<size_t>(_Mypeak.load(_STD memory_order_relaxed)),
+            _Myreserved.load(_STD memory_order_relaxed)};
+    }
+
+private:
+    _Memory_usage() noexcept : _Mybytes(0), _Mypeak(0), _Myreserved(0) {}
+
+    atomic<ptrdiff_t> _Mybytes;
+    atomic<ptrdiff_t> _Mypeak;
+    atomic<size_t> _Myreserved;
+};
+
+#if _TPLMGR_POOL_ALLOCATOR
+// CONSTANT _Pool_granularity
+static constexpr size_t _Pool_granularity = 16; // size classes are multiples of this (and aligned to it)
+
+// CONSTANT _Pool_max_block_size
+static constexpr size_t _Pool_max_block_size = 256; // larger blocks are allocated from the heap
+
+// CONSTANT _Pool_class_count
+static constexpr size_t _Pool_class_count = _Pool_max_block_size / _Pool_granularity;
+
+// CONSTANT _Pool_span_size
+static constexpr size_t _Pool_span_size = 64 * 1024; // the central store carves blocks from spans
+
+// CONSTANT _Pool_report_threshold
+static constexpr ptrdiff_t _Pool_report_threshold = 16 * 1024; // max unreported bytes per thread
+
+// FUNCTION _Is_pooled
+static constexpr bool _Is_pooled(const size_t _Size, const size_t _Align) noexcept {
+    return _Size <= _Pool_max_block_size && _Align <= _Pool_granularity;
+}
+
+// FUNCTION _Pool_class_of
+static constexpr size_t _Pool_class_of(const size_t _Size) noexcept {
+    return (_Size - 1) / _Pool_granularity;
+}
+
+// FUNCTION _Pool_block_size
+static constexpr size_t _Pool_block_size(const size_t _Class) noexcept {
+    return (_Class + 1) * _Pool_granularity;
+}
+
+// FUNCTION _Pool_batch_size
+static constexpr size_t _Pool_batch_size(const size_t _Class) noexcept {
+    // Note: A thread cache exchanges roughly 4 KiB with the central store at once,
+    //       but never less than 8 or more than 64 blocks.
+    const size_t _Count = 4096 / _Pool_block_size(_Class);
+    return _Count < 8 ? 8 : (_Count > 64 ? 64 : _Count);
+}
+
+// STRUCT _Pool_block
+struct _Pool_block { // a free block, its first bytes are reused as a link
+    _Pool_block* _Next;
+};
+
+// STRUCT _Pool_central_list
+struct _Pool_central_list {
+    shared_lock _Lock;
+    _Pool_block* _Free = nullptr; // blocks returned by the threads
+    unsigned char* _Unused = nullptr; // the first byte of the current span that was never used
+    unsigned char* _Unused_end = nullptr; // the end of the current span
+};
+
+// CLASS _Pool_central_store
+class _Pool_central_store { // shared store of free blocks, one list per size class
+public:
+    static _Pool_central_store& _Instance() noexcept {
+        // Note: The store is never destroyed because blocks may be deallocated
+        //       by thread-local or static destructors that run after it.
+        alignas(_Pool_central_store) static unsigned char _Storage[sizeof(_Pool_central_store)];
+        static _Pool_central_store* const _Store = ::new (static_cast<void*>(_Storage)) _Pool_central_store;
+        return *_Store;
+    }
+
+    // takes up to _Count blocks, links them and returns the number of taken blocks
+    size_t _Take(const size_t _Class, const size_t _Count, _Pool_block*& _First) noexcept {
+        _Pool_central_list& _List = _Mylists[_Class];
+        const size_t _Size        = _Pool_block_size(_Class);
+        size_t _Taken             = 0;
+        _First                    = nullptr;
+        lock_guard _Guard(_List._Lock);
+        while (_Taken < _Count && _List._Free) { // reuse returned blocks first
+            _Pool_block* const _Block = _List._Free;
+            _List._Free               = _Block->_Next;
+            _Block->_Next             = _First;
+            _First                    = _Block;
+            ++_Taken;
+        }
+
+        while (_Taken < _Count) { // carve new blocks from the current span
+            if (static_cast<size_t>(_List._Unused_end - _List._Unused) < _Size) { // allocate a new span
+                void* const _Span = _Allocate_from_heap(_Pool_span_size, _Pool_granularity);
+                if (!_Span) { // allocation failed, return what is available
+                    break;
+                }
+
+                _Memory_usage::_Instance()._Reserve(_Pool_span_size);
+                _List._Unused     = static_cast<unsigned char*>(_Span);
+                _List._Unused_end = _List._Unused + _Pool_span_size;
+            }
+
+            _First = ::new (static_cast<void*>(_List._Unused)) _Pool_block{_First};
+            _List._Unused += _Size;
+            ++_Taken;
+        }
+
+        return _Taken;
+    }
+
+    // returns a linked list of blocks
+    void _Give(const size_t _Class, _Pool_block* const _First, _Pool_block* const _Last) noexcept {
+        _Pool_central_list& _List = _Mylists[_Class];
+        lock_guard _Guard(_List._Lock);
+        _Last->_Next = _List._Free;
+        _List._Free  = _First;
+    }
+
+private:
+    _Pool_central_store() noexcept : _Mylists() {}
+
+    _Pool_central_list _Mylists[_Pool_class_count];
+};
+
+// STRUCT _Pool_cache_list
+struct _Pool_cache_list {
+    _Pool_block* _Head = nullptr; // the most recently deallocated block
+    size_t _Size       = 0; // number of cached blocks
+};
+
+// CLASS _Pool_thread_cache
+class _Pool_thread_cache { // per-thread cache of free blocks
+public:
+    _Pool_thread_cache() noexcept : _Mylists(), _Myunreported(0) {}
+
+    ~_Pool_thread_cache() noexcept;
+
+    _Pool_thread_cache(const _Pool_thread_cache&) = delete;
+    _Pool_thread_cache& operator=(const _Pool_thread_cache&) = delete;
+
+    void* _Allocate(const size_t _Class) noexcept {
+        _Pool_cache_list& _List = _Mylists[_Class];
+        if (!_List._Head) { // take a batch from the central store
+            _List._Size = _Pool_central_store::_Instance()._Take(_Class, _Pool_batch_size(_Class), _List._Head);
+            if (_List._Size == 0) { // allocation failed
+                return nullptr;
+            }
+        }
+
+        _Pool_block* const _Block = _List._Head;
+        _List._Head               = _Block->_Next;
+        --_List._Size;
+        _Report(static_cast<ptrdiff_t>(_Pool_block_size(_Class)));
+        return _Block;
+    }
+
+    void _Deallocate(void* const _Ptr, const size_t _Class) noexcept {
+        // Note: A block may be deallocated by any thread. It goes to the deallocating thread's cache,
+        //       which returns the least recently used half to the central store once it is full.
+        _Pool_cache_list& _List = _Mylists[_Class];
+        _List._Head             = ::new (_Ptr) _Pool_block{_List._Head};
+        ++_List._Size;
+        _Report(-static_cast<ptrdiff_t>(_Pool_block_size(_Class)));
+        const size_t _Batch = _Pool_batch_size(_Class);
+        if (_List._Size >= 2 * _Batch) {
+            _Pool_block* _Keep_last = _List._Head;
+            for (size_t _Idx = 1; _Idx < _Batch; ++_Idx) {
+                _Keep_last = _Keep_last->_Next;
+            }
+
+            _Pool_block* const _First = _Keep_last->_Next;
+            _Pool_block* _Last        = _First;
+            while (_Last->_Next) {
+                _Last = _Last->_Next;
+            }
+
+            _Keep_last->_Next = nullptr;
+            _List._Size       = _Batch;
+            _Pool_central_store::_Instance()._Give(_Class, _First, _Last);
+        }
+    }
+
+private:
+    void _Report(const ptrdiff_t _Bytes) noexcept {
+        _Myunreported += _Bytes;
+        if (_Myunreported >= _Pool_report_threshold || _Myunreported <= -_Pool_report_threshold) {
+            _Memory_usage::_Instance()._Add(_Myunreported);
+            _Myunreported = 0;
+        }
+    }
+
+    _Pool_cache_list _Mylists[_Pool_class_count];
+    ptrdiff_t _Myunreported; // bytes allocated (or deallocated if negative) but not reported yet
+};
+
+static thread_local bool _Pool_cache_destroyed = false;
+
+_Pool_thread_cache::~_Pool_thread_cache() noexcept {
+    _Pool_central_store& _Store = _Pool_central_store::_Instance();
+    for (size_t _Class = 0; _Class < _Pool_class_count; ++_Class) { // return all cached blocks
+        _Pool_cache_list& _List = _Mylists[_Class];
+        if (_List._Head) {
+            _Pool_block* _Last = _List._Head;
+            while (_Last->_Next) {
+                _Last = _Last->_Next;
+            }
+
+            _Store._Give(_Class, _List._Head, _Last);
+            _List._Head = nullptr;
+            _List._Size = 0;
+        }
+    }
+
+    _Memory_usage::_Instance()._Add(_Myunreported);
+    _Myunreported         = 0;
+    _Pool_cache_destroyed = true;
+}
+
+// FUNCTION _Current_pool_cache
+static _Pool_thread_cache* _Current_pool_cache() noexcept {
+    if (_Pool_cache_destroyed) { // the thread is exiting, use the central store directly
+        return nullptr;
+    }
+
+    static thread_local _Pool_thread_cache _Cache;
+    return _TPLMGR addressof(_Cache);
+}
+
+// FUNCTION _Allocate_from_pool
+static void* _Allocate_from_pool(const size_t _Size) noexcept {
+    const size_t _Class = _Pool_class_of(_Size);
+    _Pool_thread_cache* const _Cache = _Current_pool_cache();
+    if (_Cache) {
+        return _Cache->_Allocate(_Class);
+    }
+
+    _Pool_block* _Block;
+    if (_Pool_central_store::_Instance()._Take(_Class, 1, _Block) == 0) { // allocation failed
+        return nullptr;
+    }
+
+    _Memory_usage::_Instance()._Add(static_cast<ptrdiff_t>(_Pool_block_size(_Class)));
+    return _Block;
+}
+
+// FUNCTION _Deallocate_to_pool
+static void _Deallocate_to_pool(void* const _Ptr, const size_t _Size) noexcept {
+    const size_t _Class = _Pool_class_of(_Size);
+    _Pool_thread_cache* const _Cache = _Current_pool_cache();
+    if (_Cache) {
+        _Cache->_Deallocate(_Ptr, _Class);
+        return;
+    }
+
+    _Pool_block* const _Block = ::new (_Ptr) _Pool_block{nullptr};
+    _Pool_central_store::_Instance()._Give(_Class, _Block, _Block);
+    _Memory_usage::_Instance()._Add(-static_cast<ptrdiff_t>(_Pool_block_size(_Class)));
+}
+#endif // _TPLMGR_POOL_ALLOCATOR
+
 // FUNCTION allocator_traits::allocate
-_NODISCARD_ATTR __declspec(allocator) allocator_traits::pointer allocator_traits::allocate(
+_NODISCARD_ATTR _MSVC_ALLOCATOR allocator_traits::pointer allocator_traits::allocate(
     const size_type _Size, const size_type _Align) noexcept {
     if (_Size == 0) { // no allocation
         return nullptr;
     }
 
-#ifdef __cpp_aligned_new
     if (!_Is_pow_of_2(_Align)) { // alignment must be a power of 2
         return nullptr;
     }
 
-    return ::operator new(_Size, align_val_t{_Align}, _STD nothrow);
-#else // ^^^ __cpp_aligned_new ^^^ / vvv !__cpp_aligned_new vvv
-    (void) _Align; // alignment not used
-    return ::operator new(_Size, _STD nothrow);
-#endif // __cpp_aligned_new
+#if _TPLMGR_POOL_ALLOCATOR
+    if (_Is_pooled(_Size, _Align)) { // small allocation, use the pool
+        return _Allocate_from_pool(_Size);
+    }
+#endif // _TPLMGR_POOL_ALLOCATOR
+
+    void* const _Ptr = _Allocate_from_heap(_Size, _Align);
+    if (_Ptr) {
+        _Memory_usage::_Instance()._Add(static_cast<ptrdiff_t>(_Size));
+    }
+
+    return _Ptr;
 }
 
 // FUNCTION allocator_traits::deallocate
@@ -39,16 +349,24 @@ void allocator_traits::deallocate(
         return;
     }
 
-#ifdef __cpp_aligned_new
     if (!_Is_pow_of_2(_Align)) { // alignment must be a power of 2
         return;
     }
 
-    ::operator delete(_Ptr, _Size, align_val_t{_Align});
-#else // ^^^ __cpp_aligned_new ^^^ / vvv !__cpp_aligned_new vvv
-    (void) _Align; // alignment not used
-    ::operator delete(_Ptr, _Size);
-#endif // __cpp_aligned_new
+#if _TPLMGR_POOL_ALLOCATOR
+    if (_Is_pooled(_Size, _Align)) { // small allocation, return it to the pool
+        _Deallocate_to_pool(_Ptr, _Size);
+        return;
+    }
+#endif // _TPLMGR_POOL_ALLOCATOR
+
+    _Deallocate_to_heap(_Ptr, _Size, _Align);
+    _Memory_usage::_Instance()._Add(-static_cast<ptrdiff_t>(_Size));
+}
+
+// FUNCTION allocator_traits::statistics
+allocator_statistics allocator_traits::statistics() noexcept {
+    return _Memory_usage::_Instance()._Statistics();
 }
 _TPLMGR_END
 
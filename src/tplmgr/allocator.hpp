@@ -24,11 +24,18 @@ using _STD align_val_t;
 // CONSTANT TEMPLATE _Default_new_alignof
 template <class _Ty>
 _INLINE_VARIABLE constexpr size_t _Default_new_alignof = (_STD max)(
-    _DEFAULT_NEW_ALIGNMENT, alignof(_Ty)); // choose default allocation alignment
+    static_cast<size_t>(_DEFAULT_NEW_ALIGNMENT), alignof(_Ty)); // choose default allocation alignment
 
 // FUNCTION _Is_pow_of_2
 extern constexpr bool _Is_pow_of_2(const size_t _Val) noexcept;
 
+// STRUCT allocator_statistics
+struct allocator_statistics {
+    size_t bytes_in_use; // bytes allocated and not yet deallocated (updated in batches)
+    size_t peak_bytes_in_use; // the high-water mark of bytes_in_use
+    size_t reserved_bytes; // bytes held by the pools (including free blocks)
+};
+
 // STRUCT allocator_traits
 struct _TPLMGR_API allocator_traits {
     using value_type      = void;
@@ -43,6 +50,9 @@ struct _TPLMGR_API allocator_traits {
 
     // tries to deallocate _Size bytes of memory (alignment is optional)
     static void deallocate(pointer _Ptr, const size_type _Size, const size_type _Align) noexcept;
+
+    // returns the current memory usage
+    static allocator_statistics statistics() noexcept;
 };
 
 // CLASS TEMPLATE allocator
@@ -72,7 +82,7 @@ public:
     _NODISCARD_ATTR _CONSTEXPR_DYNAMIC_ALLOC
         _MSVC_ALLOCATOR pointer allocate(const size_type _Count) noexcept {
         return static_cast<pointer>(
-            allocator_traits::allocate(_Count * sizeof(_Ty)), _Default_new_alignof<_Ty>);
+            allocator_traits::allocate(_Count * sizeof(_Ty), _Default_new_alignof<_Ty>));
     }
 
     template <class _Other, class... _Types>
@@ -140,6 +150,117 @@ public:
         return static_cast<size_type>(-1);
     }
 };
+// CONSTANT _Default_free_list_capacity
+_INLINE_VARIABLE constexpr size_t _Default_free_list_capacity = 64; // default max number of retired nodes
+
+// CLASS TEMPLATE _Node_free_list
+template <class _Node>
+class _Node_free_list { // per-container cache of retired nodes (not thread-safe)
+private:
+    // Note: A retired node is raw memory, its first bytes are reused as a link to the next retired node.
+    //       A container allocates and deallocates its nodes through this list, so repeatedly filling
+    //       and draining the container reuses the same nodes instead of going through the heap.
+    struct _Retired_node {
+        _Retired_node* _Next;
+    };
+
+    static_assert(sizeof(_Node) >= sizeof(_Retired_node), "The node must be able to store a link.");
+
+public:
+    using size_type = size_t;
+
+    _Node_free_list() noexcept : _Myhead(nullptr), _Mysize(0), _Mycapacity(_Default_free_list_capacity) {}
+
+    ~_Node_free_list() noexcept {
+        _Shrink_to_fit();
+    }
+
+    _Node_free_list(const _Node_free_list&) = delete;
+    _Node_free_list& operator=(const _Node_free_list&) = delete;
+
+    // returns the number of cached nodes
+    size_type _Size() const noexcept {
+        return _Mysize;
+    }
+
+    // returns the max number of cached nodes
+    size_type _Capacity() const noexcept {
+        return _Mycapacity;
+    }
+
+    // changes the max number of cached nodes, frees the nodes above the new limit
+    void _Set_capacity(const size_type _New_capacity) noexcept {
+        _Mycapacity = _New_capacity;
+        _Trim(_New_capacity);
+    }
+
+    // tries to cache at least _Count nodes, raises the limit if necessary
+    _NODISCARD_ATTR bool _Reserve(const size_type _Count) noexcept {
+        if (_Mycapacity < _Count) {
+            _Mycapacity = _Count;
+        }
+
+        allocator<void> _Al;
+        while (_Mysize < _Count) {
+            void* const _Raw = _Al.allocate(sizeof(_Node));
+            if (!_Raw) { // allocation failed
+                return false;
+            }
+
+            _Push(_Raw);
+        }
+
+        return true;
+    }
+
+    // frees all cached nodes
+    void _Shrink_to_fit() noexcept {
+        _Trim(0);
+    }
+
+    // returns a cached node or allocates a new one
+    _NODISCARD_ATTR void* _Allocate() noexcept {
+        if (_Myhead) { // reuse a retired node
+            _Retired_node* const _Retired = _Myhead;
+            _Myhead                       = _Retired->_Next;
+            --_Mysize;
+            _Retired->~_Retired_node();
+            return _Retired;
+        }
+
+        return allocator<void>{}.allocate(sizeof(_Node));
+    }
+
+    // caches a destroyed node or frees it if the limit has been reached
+    void _Deallocate(void* const _Ptr) noexcept {
+        if (_Mysize < _Mycapacity) {
+            _Push(_Ptr);
+        } else {
+            allocator<void>{}.deallocate(_Ptr, sizeof(_Node));
+        }
+    }
+
+private:
+    void _Push(void* const _Raw) noexcept {
+        _Myhead = ::new (_Raw) _Retired_node{_Myhead};
+        ++_Mysize;
+    }
+
+    void _Trim(const size_type _Count) noexcept { // frees the cached nodes above _Count
+        allocator<void> _Al;
+        while (_Mysize > _Count) {
+            _Retired_node* const _Retired = _Myhead;
+            _Myhead                       = _Retired->_Next;
+            --_Mysize;
+            _Retired->~_Retired_node();
+            _Al.deallocate(_Retired, sizeof(_Node));
+        }
+    }
+
+    _Retired_node* _Myhead; // the most recently retired node
+    size_type _Mysize; // number of cached nodes
+    size_type _Mycapacity; // max number of cached nodes
+};
 _TPLMGR_END
 
 #endif // _TPLMGR_PREPROCESSOR_GUARD
@@ -9,16 +9,63 @@
 #include <tplmgr/core.hpp>
 #if _TPLMGR_PREPROCESSOR_GUARD
 #include <tplmgr/allocator.hpp>
+#include <tplmgr/task_future.hpp>
 #include <tplmgr/thread_pool.hpp>
 #include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <tuple>
 #include <type_traits>
 
 _TPLMGR_BEGIN
 // STD types
+using _STD atomic;
 using _STD decay_t;
 using _STD tuple;
 
+// STRUCT TEMPLATE _Value_pack
+template <class _Ty, class... _Rest>
+struct _Value_pack { // aggregate of values, trivially copyable if all values are
+    _Ty _First;
+    _Value_pack<_Rest...> _Others;
+
+    template <class... _Prev>
+    decltype(auto) _Apply(_Prev&... _Values) {
+        return _Others._Apply(_Values..., _First);
+    }
+};
+
+template <class _Ty>
+struct _Value_pack<_Ty> {
+    _Ty _First;
+
+    template <class _Fn, class... _Args>
+    static decltype(auto) _Invoke(_Fn& _Func, _Args&... _Vals) {
+        return _Func(_STD move(_Vals)...);
+    }
+
+    template <class... _Prev>
+    decltype(auto) _Apply(_Prev&... _Values) { // the first value is the callable
+        return _Invoke(_Values..., _First);
+    }
+};
+
+// FUNCTION TEMPLATE _Make_value_pack
+template <class _Ty>
+_Value_pack<decay_t<_Ty>> _Make_value_pack(_Ty&& _Val) {
+    return _Value_pack<decay_t<_Ty>>{_STD forward<_Ty>(_Val)};
+}
+
+template <class _Ty, class _Uty, class... _Rest>
+_Value_pack<decay_t<_Ty>, decay_t<_Uty>, decay_t<_Rest>...> _Make_value_pack(
+    _Ty&& _Val, _Uty&& _Next, _Rest&&... _Others) {
+    // Note: The members are initialized from prvalues, so no value is moved twice.
+    return _Value_pack<decay_t<_Ty>, decay_t<_Uty>, decay_t<_Rest>...>{
+        _STD forward<_Ty>(_Val), _Make_value_pack(_STD forward<_Uty>(_Next), _STD forward<_Rest>(_Others)...)};
+}
+
 // CLASS TEMPLATE _Task_invoker
 template <class _Fn, class... _Types>
 class _Task_invoker { // converts custom function type into thread's start routine
@@ -26,10 +73,29 @@ public:
     using _Tuple = tuple<decay_t<_Fn>, decay_t<_Types>...>;
     using _Alloc = allocator<void>;
 
+    // Note: The callable and the arguments are moved (or copied if they are lvalues) into the closure,
+    //       so move-only types are supported. The closure is trivially copyable if they all are.
+    static auto _Bind(_Fn&& _Func, _Types&&... _Args) noexcept {
+        return [_Values = _Make_value_pack(_STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...)]() mutable {
+            return _Values._Apply();
+        };
+    }
+
+    using _Call = decltype(_Bind(_STD declval<_Fn>(), _STD declval<_Types>()...));
+
+    // Note: Small callables that only capture trivially copyable values (e.g. pointers) are stored
+    //       in the task itself, so scheduling them doesn't allocate. Other ones are allocated.
+    static constexpr bool _Is_inline = sizeof(_Call) <= _Inline_task_size && alignof(_Call) <= alignof(void*)
+                                    && _STD is_trivially_copyable_v<_Call>
+                                    && _STD is_trivially_destructible_v<_Call>;
+
+    static void _Get_inline_invoker(void* const _Data) {
+        (*_STD launder(static_cast<_Call*>(_Data)))();
+    }
+
     static constexpr void _Get_invoker(void* const _Data) {
         _Tuple& _Packed = *static_cast<_Tuple*>(_Data);
-        const _Fn _Func = _STD forward<_Fn>(_STD get<_Fn>(_Packed));
-        _Func(_STD forward<_Types>(_STD get<_Types>(_Packed))...);
+        _STD apply([](auto& _Func, auto&... _Args) { _Func(_STD move(_Args)...); }, _Packed);
         _Alloc _Al;
         _Packed.~_Tuple(); // destroy packed data
         _Al.deallocate(_Data, sizeof(_Tuple));
@@ -44,36 +110,167 @@ public:
 
         return ::new (_Raw) _Tuple(_STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
     }
+
+    static bool _Schedule(thread_pool& _Pool, const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) {
+        if constexpr (_Is_inline) { // store the callable in the task
+            _Thread_task _Task;
+            _Task._Func     = &_Get_inline_invoker;
+            _Task._Priority = _Priority;
+            _Task._Inline   = true;
+            ::new (static_cast<void*>(_Task._Storage))
+                _Call(_Bind(_STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...));
+            return _Pool._Schedule_task(_Task);
+        } else { // allocate the callable
+            _Tuple* const _Packed = _Pack_data(_STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
+            if (!_Packed) { // allocation failed, do nothing
+                return false;
+            }
+
+            if (!_Pool.schedule_task(&_Get_invoker, _Packed, _Priority)) { // the task will never run
+                _Packed->~_Tuple();
+                _Alloc{}.deallocate(_Packed, sizeof(_Tuple));
+                return false;
+            }
+
+            return true;
+        }
+    }
+};
+
+// Note: A callable with up to 3 pointer arguments (or a lambda capturing them) must not allocate.
+static_assert(_Task_invoker<void(__STDCALL_OR_CDECL*)(void*, void*, void*), void*, void*, void*>::_Is_inline,
+    "small tasks must be stored inline");
+
+// CLASS TEMPLATE _Bulk_task_invoker
+template <class _Fn>
+class _Bulk_task_invoker { // converts custom function type into the start routine of many tasks
+public:
+    using _Func_t = decay_t<_Fn>;
+    using _Alloc  = allocator<void>;
+
+    struct _Shared_state;
+
+    struct _Task_data {
+        _Shared_state* _State;
+        size_t _Index;
+    };
+
+    struct _Shared_state {
+        _Func_t _Func;
+        atomic<size_t> _Refs; // number of tasks that haven't finished yet
+        size_t _Bytes; // size of the whole allocation
+    };
+
+    // Note: The shared state, the data of each task and the pointers to them are stored
+    //       in a single allocation, which is released by the last finished task.
+    static constexpr size_t _Data_offset =
+        (sizeof(_Shared_state) + alignof(_Task_data) - 1) & ~(alignof(_Task_data) - 1);
+
+    static void _Get_invoker(void* const _Data) {
+        const _Task_data& _Unpacked = *static_cast<const _Task_data*>(_Data);
+        _Shared_state* const _State = _Unpacked._State;
+        static_cast<const _Func_t&>(_State->_Func)(_Unpacked._Index);
+        _Release(_State, 1);
+    }
+
+    static void _Release(_Shared_state* const _State, const size_t _Count) noexcept {
+        if (_State->_Refs.fetch_sub(_Count, _STD memory_order_acq_rel) == _Count) { // the last task
+            _Alloc _Al;
+            const size_t _Bytes = _State->_Bytes;
+            _State->~_Shared_state();
+            _Al.deallocate(_State, _Bytes);
+        }
+    }
+
+    static bool _Schedule(thread_pool& _Pool, const task_priority _Priority, const size_t _Count, _Fn&& _Func) {
+        if (_Count == 0) { // nothing to do
+            return true;
+        }
+
+        constexpr size_t _Per_task = sizeof(_Task_data) + sizeof(void*);
+        if (_Count > (SIZE_MAX - _Data_offset) / _Per_task) { // too many tasks
+            return false;
+        }
+
+        _Alloc _Al;
+        const size_t _Bytes = _Data_offset + _Count * _Per_task;
+        void* const _Raw    = _Al.allocate(_Bytes);
+        if (!_Raw) { // allocation failed
+            return false;
+        }
+
+        _Shared_state* const _State = ::new (_Raw) _Shared_state{_STD forward<_Fn>(_Func), {_Count}, _Bytes};
+        _Task_data* const _Tasks    = reinterpret_cast<_Task_data*>(static_cast<char*>(_Raw) + _Data_offset);
+        void** const _Data          = reinterpret_cast<void**>(_Tasks + _Count);
+        for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+            _Data[_Idx] = ::new (static_cast<void*>(_Tasks + _Idx)) _Task_data{_State, _Idx};
+        }
+
+        const size_t _Scheduled = _Pool.schedule_tasks(&_Get_invoker, _Data, _Count, _Priority);
+        if (_Scheduled < _Count) { // the remaining tasks will never run, release them
+            _Release(_State, _Count - _Scheduled);
+            return false;
+        }
+
+        return true;
+    }
 };
 
 // FUNCTION TEMPLATE async
 template <class _Fn, class... _Types>
 _NODISCARD_ATTR bool async(thread_pool& _Pool, _Fn&& _Func, _Types&&... _Args) noexcept {
-    using _Invoker_t        = _Task_invoker<_Fn, _Types...>;
-    using _Tuple_t          = typename _Invoker_t::_Tuple;
-    const auto _Invoker     = &_Invoker_t::_Get_invoker;
-    _Tuple_t* const _Packed = _Invoker_t::_Pack_data(
-        _STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
-    if (_Packed) { // allocation succeeded, try schedule a new task
-        return _Pool.schedule_task(_Invoker, _Packed);
-    } else { // allocation failed, do nothing
-        return false;
-    }
+    return _Task_invoker<_Fn, _Types...>::_Schedule(
+        _Pool, task_priority::normal, _STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
 }
 
 template <class _Fn, class... _Types>
 _NODISCARD_ATTR bool async(
     thread_pool& _Pool, const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) noexcept {
-    using _Invoker_t        = _Task_invoker<_Fn, _Types...>;
-    using _Tuple_t          = typename _Invoker_t::_Tuple;
-    const auto _Invoker     = &_Invoker_t::_Get_invoker;
-    _Tuple_t* const _Packed = _Invoker_t::_Pack_data(
-        _STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
-    if (_Packed) { // allocation succeeded, try schedule a new task
-        return _Pool.schedule_task(_Invoker, _Packed, _Priority);
-    } else { // allocation failed, do nothing
-        return false;
+    return _Task_invoker<_Fn, _Types...>::_Schedule(
+        _Pool, _Priority, _STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
+}
+
+// FUNCTION TEMPLATE async_with_result
+template <class _Fn, class... _Types>
+_NODISCARD_ATTR auto async_with_result(
+    thread_pool& _Pool, const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) noexcept {
+    // Note: The shared state and the callable are stored in a single allocation.
+    //       The returned future is invalid if the task couldn't be allocated or scheduled.
+    using _Call_t   = typename _Task_invoker<_Fn, _Types...>::_Call;
+    using _Result_t = decay_t<decltype(_STD declval<_Call_t&>()())>;
+    using _Task_t   = _Future_task<_Result_t, _Call_t>;
+    _Task_t* const _Task =
+        _Task_t::_Create(_Task_invoker<_Fn, _Types...>::_Bind(_STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...));
+    if (!_Task) { // allocation failed
+        return task_future<_Result_t>{};
+    }
+
+    if (!_Pool._Schedule_task(_Task->_Get_task(_Priority))) { // the task will never run
+        _Task_t::_Discard(_Task);
+        return task_future<_Result_t>{};
     }
+
+    return task_future<_Result_t>{_Task};
+}
+
+template <class _Fn, class... _Types>
+_NODISCARD_ATTR auto async_with_result(thread_pool& _Pool, _Fn&& _Func, _Types&&... _Args) noexcept {
+    return _TPLMGR async_with_result(
+        _Pool, task_priority::normal, _STD forward<_Fn>(_Func), _STD forward<_Types>(_Args)...);
+}
+
+// FUNCTION TEMPLATE async_bulk
+template <class _Fn>
+_NODISCARD_ATTR bool async_bulk(thread_pool& _Pool, const size_t _Count, _Fn&& _Func) noexcept {
+    // Note: _Func(0), ..., _Func(_Count - 1) are invoked concurrently on the same object.
+    //       If some tasks couldn't be scheduled, false is returned, but the scheduled ones still run.
+    return _Bulk_task_invoker<_Fn>::_Schedule(_Pool, task_priority::normal, _Count, _STD forward<_Fn>(_Func));
+}
+
+template <class _Fn>
+_NODISCARD_ATTR bool async_bulk(
+    thread_pool& _Pool, const task_priority _Priority, const size_t _Count, _Fn&& _Func) noexcept {
+    return _Bulk_task_invoker<_Fn>::_Schedule(_Pool, _Priority, _Count, _STD forward<_Fn>(_Func));
 }
 _TPLMGR_END
 
@@ -0,0 +1,195 @@
+// bounded_shared_queue.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_BOUNDED_SHARED_QUEUE_HPP_
+#define _TPLMGR_BOUNDED_SHARED_QUEUE_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// STRUCT TEMPLATE _Bounded_queue_cell
+template <class _Ty>
+struct _Bounded_queue_cell {
+    atomic<size_t> _Seq; // sequence number, tells whether the cell is free or full
+    alignas(_Ty) unsigned char _Storage[sizeof(_Ty)]; // the stored value (if full)
+};
+
+// CLASS TEMPLATE bounded_shared_queue
+template <class _Ty, size_t _Size>
+class bounded_shared_queue { // non-throwing lock-free fixed-capacity queue (no allocations)
+private:
+    static_assert(_Size >= 2 && (_Size & (_Size - 1)) == 0, "The capacity must be a power of 2.");
+    static_assert(_STD is_nothrow_move_constructible_v<_Ty> && _STD is_nothrow_destructible_v<_Ty>,
+        "The value type must be nothrow move constructible and destructible.");
+
+    using _Cell_t = _Bounded_queue_cell<_Ty>;
+
+    static constexpr size_t _Mask = _Size - 1;
+
+public:
+    using value_type      = _Ty;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+    using pointer         = _Ty*;
+    using const_pointer   = const _Ty*;
+    using reference       = _Ty&;
+    using const_reference = const _Ty&;
+
+    // Note: The cell at position P is free if its sequence number equals P and holds a value
+    //       if it equals P + 1 (D. Vyukov's algorithm). A producer or consumer claims a position
+    //       with a single CAS, then publishes the cell by storing the next sequence number.
+    //       All cells are part of the object, so neither push nor pop ever allocates.
+    bounded_shared_queue() noexcept : _Mycells(), _Myenqueue(0), _Mydequeue(0) {
+        for (size_t _Idx = 0; _Idx < _Size; ++_Idx) {
+            _Mycells[_Idx]._Seq.store(_Idx, _STD memory_order_relaxed);
+        }
+    }
+
+    ~bounded_shared_queue() noexcept {
+        size_t _Pos;
+        while (_Cell_t* const _Cell = _Claim_front(_Pos)) { // destroy the remaining values
+            _Value_of(*_Cell).~value_type();
+            _Publish_front(*_Cell, _Pos);
+        }
+    }
+
+    bounded_shared_queue(const bounded_shared_queue&) = delete;
+    bounded_shared_queue& operator=(const bounded_shared_queue&) = delete;
+
+    // returns the max number of values
+    static constexpr size_type capacity() noexcept {
+        return _Size;
+    }
+
+    size_type max_size() const noexcept {
+        return _Size;
+    }
+
+    // returns the number of values (may be outdated)
+    size_type size() const noexcept {
+        const size_t _Dequeue = _Mydequeue.load(_STD memory_order_relaxed);
+        const size_t _Enqueue = _Myenqueue.load(_STD memory_order_relaxed);
+        const size_t _Diff    = _Enqueue - _Dequeue;
+        return _Diff <= _Size ? _Diff : 0; // ignore transient inconsistencies
+    }
+
+    // checks if the queue is empty (may be outdated)
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // checks if the queue is full (may be outdated)
+    bool full() const noexcept {
+        return size() == _Size;
+    }
+
+    // tries to append a new value, fails if the queue is full
+    _NODISCARD_ATTR bool try_push(const value_type& _Val) noexcept {
+        static_assert(_STD is_nothrow_copy_constructible_v<_Ty>,
+            "The value type must be nothrow copy constructible to be copied into the queue.");
+        size_t _Pos;
+        _Cell_t* const _Cell = _Claim_back(_Pos);
+        if (!_Cell) { // the queue is full
+            return false;
+        }
+
+        ::new (static_cast<void*>(_Cell->_Storage)) value_type(_Val);
+        _Publish_back(*_Cell, _Pos);
+        return true;
+    }
+
+    _NODISCARD_ATTR bool try_push(value_type&& _Val) noexcept {
+        size_t _Pos;
+        _Cell_t* const _Cell = _Claim_back(_Pos);
+        if (!_Cell) { // the queue is full
+            return false;
+        }
+
+        ::new (static_cast<void*>(_Cell->_Storage)) value_type(_STD move(_Val));
+        _Publish_back(*_Cell, _Pos);
+        return true;
+    }
+
+    // tries to remove the oldest value, fails if the queue is empty
+    _NODISCARD_ATTR bool try_pop(value_type& _Val) noexcept {
+        size_t _Pos;
+        _Cell_t* const _Cell = _Claim_front(_Pos);
+        if (!_Cell) { // the queue is empty
+            return false;
+        }
+
+        value_type& _Front = _Value_of(*_Cell);
+        _Val               = _STD move(_Front);
+        _Front.~value_type();
+        _Publish_front(*_Cell, _Pos);
+        return true;
+    }
+
+private:
+    static value_type& _Value_of(_Cell_t& _Cell) noexcept {
+        return *_STD launder(reinterpret_cast<value_type*>(_Cell._Storage));
+    }
+
+    _Cell_t* _Claim_back(size_t& _Pos) noexcept { // returns the claimed free cell or null
+        _Pos = _Myenqueue.load(_STD memory_order_relaxed);
+        for (;;) {
+            _Cell_t& _Cell               = _Mycells[_Pos & _Mask];
+            const size_t _Seq            = _Cell._Seq.load(_STD memory_order_acquire);
+            const difference_type _Delta = static_cast<difference_type>(_Seq - _Pos);
+            if (_Delta == 0) { // the cell is free, try to claim it
+                if (_Myenqueue.compare_exchange_weak(_Pos, _Pos + 1, _STD memory_order_relaxed)) {
+                    return _TPLMGR addressof(_Cell);
+                }
+            } else if (_Delta < 0) { // the cell still holds a value from the previous lap
+                return nullptr;
+            } else { // another producer has claimed the cell
+                _Pos = _Myenqueue.load(_STD memory_order_relaxed);
+            }
+        }
+    }
+
+    static void _Publish_back(_Cell_t& _Cell, const size_t _Pos) noexcept { // the cell holds a value now
+        _Cell._Seq.store(_Pos + 1, _STD memory_order_release);
+    }
+
+    _Cell_t* _Claim_front(size_t& _Pos) noexcept { // returns the claimed full cell or null
+        _Pos = _Mydequeue.load(_STD memory_order_relaxed);
+        for (;;) {
+            _Cell_t& _Cell               = _Mycells[_Pos & _Mask];
+            const size_t _Seq            = _Cell._Seq.load(_STD memory_order_acquire);
+            const difference_type _Delta = static_cast<difference_type>(_Seq - (_Pos + 1));
+            if (_Delta == 0) { // the cell holds a value, try to claim it
+                if (_Mydequeue.compare_exchange_weak(_Pos, _Pos + 1, _STD memory_order_relaxed)) {
+                    return _TPLMGR addressof(_Cell);
+                }
+            } else if (_Delta < 0) { // the cell is empty
+                return nullptr;
+            } else { // another consumer has claimed the cell
+                _Pos = _Mydequeue.load(_STD memory_order_relaxed);
+            }
+        }
+    }
+
+    static void _Publish_front(_Cell_t& _Cell, const size_t _Pos) noexcept { // free for the next lap
+        _Cell._Seq.store(_Pos + _Size, _STD memory_order_release);
+    }
+
+    _Cell_t _Mycells[_Size];
+    alignas(_Cache_line_size) atomic<size_t> _Myenqueue; // the next position to push to
+    alignas(_Cache_line_size) atomic<size_t> _Mydequeue; // the next position to pop from
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_BOUNDED_SHARED_QUEUE_HPP_
\ No newline at end of file
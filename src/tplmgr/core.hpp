@@ -7,13 +7,14 @@
 #ifndef _TPLMGR_CORE_HPP_
 #define _TPLMGR_CORE_HPP_
 
-// Each header should be protected against C++/CLI and non-Windows platform.
+// Each header should be protected against C++/CLI and unsupported platforms.
 #ifndef _TPLMGR_PREPROCESSOR_GUARD
-#if defined(_M_CEE) || !defined(_WIN32)
+#if defined(_M_CEE) || (!defined(_WIN32) && !defined(__linux__))
 #define _TPLMGR_PREPROCESSOR_GUARD 0
-#else // ^^^ defined(_M_CEE) || !defined(_WIN32) ^^^ / vvv !defined(_M_CEE) && defined(_WIN32) vvv
+#else // ^^^ defined(_M_CEE) || (!defined(_WIN32) && !defined(__linux__)) ^^^
+      // vvv !defined(_M_CEE) && (defined(_WIN32) || defined(__linux__)) vvv
 #define _TPLMGR_PREPROCESSOR_GUARD 1
-#endif // defined(_M_CEE) || !defined(_WIN32)
+#endif // defined(_M_CEE) || (!defined(_WIN32) && !defined(__linux__))
 #endif // _TPLMGR_PREPROCESSOR_GUARD
 
 #if _TPLMGR_PREPROCESSOR_GUARD
@@ -30,15 +31,40 @@
 #endif // !_HAS_CXX11_FEATURES
 
 // Only 32/64-bit platforms are supported.
-#if !defined(_M_IX86) && !defined(_M_X64)
+#if !defined(_M_IX86) && !defined(_M_X64) && !defined(__i386__) && !defined(__x86_64__) \
+    && !defined(__aarch64__)
 #error Requires 32/64-bit platform.
-#endif // !defined(_M_IX86) && !defined(_M_X64)
-
+#endif // !defined(_M_IX86) && !defined(_M_X64) && !defined(__i386__) && !defined(__x86_64__)
+       // && !defined(__aarch64__)
+
+// The STD namespace (defined by the MSVC STL only).
+#ifndef _STD
+#define _STD ::std::
+#endif // _STD
+
+// The static library exports nothing, the shared library exports the public API.
+#if defined(_TPLMGR_STATIC)
+#define _TPLMGR_API
+#elif defined(_WIN32) // ^^^ _TPLMGR_STATIC ^^^ / vvv _WIN32 vvv
 #ifdef _BUILD_TPLMGR
 #define _TPLMGR_API __declspec(dllexport)
 #else // ^^^ _BUILD_TPLMGR ^^^ / vvv !_BUILD_TPLMGR vvv
 #define _TPLMGR_API __declspec(dllimport)
 #endif // _BUILD_TPLMGR
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+#define _TPLMGR_API [[gnu::visibility("default")]]
+#endif // defined(_TPLMGR_STATIC)
+
+// The calling conventions are meaningful only on Windows.
+#ifndef _WIN32
+#ifndef __stdcall
+#define __stdcall
+#endif // __stdcall
+
+#ifndef __cdecl
+#define __cdecl
+#endif // __cdecl
+#endif // _WIN32
 
 // Use the __cdecl for 32-bit platforms and the __stdcall for 64-bit platforms.
 #ifndef __STDCALL_OR_CDECL
@@ -63,19 +89,25 @@
 #ifdef __STDCPP_DEFAULT_NEW_ALIGNMENT__
 #define _DEFAULT_NEW_ALIGNMENT __STDCPP_DEFAULT_NEW_ALIGNMENT__
 #else // ^^^ __STDCPP_DEFAULT_NEW_ALIGNMENT__ ^^^ / vvv !__STDCPP_DEFAULT_NEW_ALIGNMENT__ vvv
-#ifdef _M_X64
+#if defined(_M_X64) || defined(__x86_64__) || defined(__aarch64__)
 #define _DEFAULT_NEW_ALIGNMENT 8
-#else // ^^^ _M_X64 ^^^ / vvv _M_IX86 vvv
+#else // ^^^ 64-bit ^^^ / vvv 32-bit vvv
 #define _DEFAULT_NEW_ALIGNMENT 4
-#endif // _M_X64
+#endif // defined(_M_X64) || defined(__x86_64__) || defined(__aarch64__)
 #endif // __STDCPP_DEFAULT_NEW_ALIGNMENT__
 #endif // _DEFAULT_NEW_ALIGNMENT
 
-#if defined(_MSC_VER) || defined(__clang__)
+#if defined(_MSC_VER) || (defined(__clang__) && defined(_WIN32))
 #define _MSVC_ALLOCATOR __declspec(allocator)
-#else // ^^^ defined(_MSC_VER) || defined(__clang__) ^^^ / vvv !defined(_MSC_VER) && !defined(__clang__) vvv
+#else // ^^^ defined(_MSC_VER) || (defined(__clang__) && defined(_WIN32)) ^^^
+      // vvv !defined(_MSC_VER) && (!defined(__clang__) || !defined(_WIN32)) vvv
 #define _MSVC_ALLOCATOR
-#endif // defined(_MSC_VER) || defined(__clang__)
+#endif // defined(_MSC_VER) || (defined(__clang__) && defined(_WIN32))
+
+// small allocations are served by thread-cached pools (set to 0 to use only ::operator new)
+#ifndef _TPLMGR_POOL_ALLOCATOR
+#define _TPLMGR_POOL_ALLOCATOR 1
+#endif // _TPLMGR_POOL_ALLOCATOR
 
 // TPLMGR namespace
 #define _TPLMGR_BEGIN namespace tplmgr {
@@ -110,5 +142,13 @@
 #define _CONSTEXPR_DYNAMIC_ALLOC
 #endif // __cpp_constexpr_dynamic_alloc
 
+// C++20 Coroutines, see P0912R5
+#if _HAS_CXX20_FEATURES && defined(__cpp_impl_coroutine)
+#define _HAS_CXX20_COROUTINES 1
+#else // ^^^ _HAS_CXX20_FEATURES && defined(__cpp_impl_coroutine) ^^^
+      // vvv !_HAS_CXX20_FEATURES || !defined(__cpp_impl_coroutine) vvv
+#define _HAS_CXX20_COROUTINES 0
+#endif // _HAS_CXX20_FEATURES && defined(__cpp_impl_coroutine)
+
 #endif // _TPLMGR_PREPROCESSOR_GUARD
 #endif // _TPLMGR_CORE_HPP_
\ No newline at end of file
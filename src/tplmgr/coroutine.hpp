@@ -0,0 +1,257 @@
+// coroutine.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_COROUTINE_HPP_
+#define _TPLMGR_COROUTINE_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#if _HAS_CXX20_COROUTINES
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/thread.hpp>
+#include <tplmgr/thread_pool.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+using _STD coroutine_handle;
+
+// CLASS TEMPLATE task
+template <class _Ty = void>
+class task;
+
+// CLASS _Task_promise_base
+class _Task_promise_base { // common part of all task promises
+public:
+    // Note: Coroutine frames come from allocator_traits, so small frames are served
+    //       by the thread-cached pools. If the allocation fails, an invalid task is returned.
+    static void* operator new(const size_t _Size) noexcept {
+        return allocator_traits::allocate(_Size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    }
+
+    static void operator delete(void* const _Ptr, const size_t _Size) noexcept {
+        allocator_traits::deallocate(_Ptr, _Size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    }
+
+    // STRUCT _Final_awaiter
+    struct _Final_awaiter { // transfers control to the awaiting coroutine (if any)
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template <class _Promise>
+        coroutine_handle<> await_suspend(const coroutine_handle<_Promise> _Coro) noexcept {
+            _Task_promise_base& _Promise_base = _Coro.promise();
+            if (_Promise_base._Mycontinuation) { // resume the awaiting coroutine without recursion
+                return _Promise_base._Mycontinuation;
+            }
+
+            atomic<uint32_t>* const _Waiter = _Promise_base._Mywaiter;
+            if (_Waiter) { // the task is waited for by sync_wait(), the frame must not be accessed anymore
+                _Waiter->store(1, _STD memory_order_release);
+                _Wake_by_address_all(*_Waiter);
+            }
+
+            return _STD noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    _STD suspend_always initial_suspend() const noexcept { // tasks start once awaited
+        return {};
+    }
+
+    _Final_awaiter final_suspend() const noexcept {
+        return {};
+    }
+
+    void unhandled_exception() const noexcept { // the tasks must handle their own exceptions
+        _STD terminate();
+    }
+
+    coroutine_handle<> _Mycontinuation = nullptr; // the coroutine that awaits this task
+    atomic<uint32_t>* _Mywaiter        = nullptr; // the flag of sync_wait()
+};
+
+// CLASS TEMPLATE _Task_promise
+template <class _Ty>
+class _Task_promise : public _Task_promise_base { // stores the task's result
+public:
+    _Task_promise() noexcept : _Myhas_value(false) {}
+
+    ~_Task_promise() noexcept {
+        if (_Myhas_value) {
+            _Get().~_Ty();
+        }
+    }
+
+    task<_Ty> get_return_object() noexcept;
+
+    static task<_Ty> get_return_object_on_allocation_failure() noexcept;
+
+    template <class _Other = _Ty>
+    void return_value(_Other&& _Val) {
+        ::new (static_cast<void*>(_Storage)) _Ty(_STD forward<_Other>(_Val));
+        _Myhas_value = true;
+    }
+
+    // moves the result out of the promise (the task must have finished)
+    _Ty _Take() noexcept {
+        return _STD move(_Get());
+    }
+
+private:
+    _Ty& _Get() noexcept {
+        return *_STD launder(reinterpret_cast<_Ty*>(_Storage));
+    }
+
+    alignas(_Ty) unsigned char _Storage[sizeof(_Ty)];
+    bool _Myhas_value;
+};
+
+template <>
+class _Task_promise<void> : public _Task_promise_base { // no result, the task only signals completion
+public:
+    task<void> get_return_object() noexcept;
+
+    static task<void> get_return_object_on_allocation_failure() noexcept;
+
+    void return_void() const noexcept {}
+
+    void _Take() const noexcept {}
+};
+
+// CLASS TEMPLATE task
+template <class _Ty>
+class task { // lazily started coroutine, non-copyable
+public:
+    using promise_type = _Task_promise<_Ty>;
+    using value_type   = _Ty;
+
+    task() noexcept : _Mycoro(nullptr) {}
+
+    explicit task(const coroutine_handle<promise_type> _Coro) noexcept : _Mycoro(_Coro) {}
+
+    task(task&& _Other) noexcept : _Mycoro(_TPLMGR exchange(_Other._Mycoro, nullptr)) {}
+
+    ~task() noexcept {
+        if (_Mycoro) {
+            _Mycoro.destroy();
+        }
+    }
+
+    task& operator=(task&& _Other) noexcept {
+        if (this != _TPLMGR addressof(_Other)) {
+            if (_Mycoro) {
+                _Mycoro.destroy();
+            }
+
+            _Mycoro = _TPLMGR exchange(_Other._Mycoro, nullptr);
+        }
+
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    // checks if the task refers to a coroutine (false if its frame couldn't be allocated)
+    bool valid() const noexcept {
+        return static_cast<bool>(_Mycoro);
+    }
+
+    // checks if the task has finished (the task must be valid)
+    bool done() const noexcept {
+        return _Mycoro.done();
+    }
+
+    // STRUCT _Awaiter
+    struct _Awaiter { // starts the task and resumes the awaiting coroutine once it has finished
+        bool await_ready() const noexcept {
+            return _Coro.done();
+        }
+
+        coroutine_handle<> await_suspend(const coroutine_handle<> _Awaiting) noexcept {
+            _Coro.promise()._Mycontinuation = _Awaiting;
+            return _Coro; // start the task without recursion
+        }
+
+        _Ty await_resume() noexcept {
+            return _Coro.promise()._Take();
+        }
+
+        coroutine_handle<promise_type> _Coro;
+    };
+
+    // starts the task (if not started yet), the awaiting coroutine continues on the thread
+    // that finishes the task (the task must be valid)
+    _Awaiter operator co_await() const noexcept {
+        return _Awaiter{_Mycoro};
+    }
+
+    coroutine_handle<promise_type> _Get_handle() const noexcept {
+        return _Mycoro;
+    }
+
+private:
+    coroutine_handle<promise_type> _Mycoro;
+};
+
+// FUNCTION TEMPLATE _Task_promise::get_return_object
+template <class _Ty>
+task<_Ty> _Task_promise<_Ty>::get_return_object() noexcept {
+    return task<_Ty>{coroutine_handle<_Task_promise>::from_promise(*this)};
+}
+
+inline task<void> _Task_promise<void>::get_return_object() noexcept {
+    return task<void>{coroutine_handle<_Task_promise>::from_promise(*this)};
+}
+
+// FUNCTION TEMPLATE _Task_promise::get_return_object_on_allocation_failure
+template <class _Ty>
+task<_Ty> _Task_promise<_Ty>::get_return_object_on_allocation_failure() noexcept {
+    return task<_Ty>{};
+}
+
+inline task<void> _Task_promise<void>::get_return_object_on_allocation_failure() noexcept {
+    return task<void>{};
+}
+
+// FUNCTION TEMPLATE sync_wait
+template <class _Ty>
+_Ty sync_wait(task<_Ty>&& _Task) noexcept {
+    // Note: The task starts on the calling thread, which then blocks until the task has finished
+    //       (e.g. on the pool's thread after co_await pool.schedule()). The task must be valid.
+    const coroutine_handle<_Task_promise<_Ty>> _Coro = _Task._Get_handle();
+    atomic<uint32_t> _Done(0);
+    _Coro.promise()._Mywaiter = _TPLMGR addressof(_Done);
+    _Coro.resume();
+    for (uint32_t _Spins = 0; _Done.load(_STD memory_order_acquire) == 0;) {
+        if (_Spins < _Default_spin_count) {
+            ++_Spins;
+            _Yield_processor();
+        } else {
+            _Wait_on_address(_Done, 0);
+        }
+    }
+
+    return _Coro.promise()._Take();
+}
+_TPLMGR_END
+
+#endif // _HAS_CXX20_COROUTINES
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_COROUTINE_HPP_
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <tplmgr/tplmgr_pch.hpp>
 
+#if defined(_WIN32) && !defined(_TPLMGR_STATIC)
 int __stdcall DllMain(HMODULE, unsigned long, void*) {
     return 1;
-}
\ No newline at end of file
+}
+#endif // defined(_WIN32) && !defined(_TPLMGR_STATIC)
\ No newline at end of file
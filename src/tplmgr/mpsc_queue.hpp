@@ -0,0 +1,342 @@
+// mpsc_queue.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_MPSC_QUEUE_HPP_
+#define _TPLMGR_MPSC_QUEUE_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// STRUCT TEMPLATE _Mpsc_queue_node
+template <class _Ty>
+struct _Mpsc_queue_node {
+    _Mpsc_queue_node() noexcept : _Next(nullptr), _Value() {}
+
+    explicit _Mpsc_queue_node(const _Ty& _Val) noexcept : _Next(nullptr), _Value(_Val) {}
+
+    explicit _Mpsc_queue_node(_Ty&& _Val) noexcept : _Next(nullptr), _Value(_STD move(_Val)) {}
+
+    ~_Mpsc_queue_node() noexcept {}
+
+    _Mpsc_queue_node(const _Mpsc_queue_node&) = delete;
+    _Mpsc_queue_node& operator=(const _Mpsc_queue_node&) = delete;
+
+    atomic<_Mpsc_queue_node*> _Next; // pointer to the next node
+    _Ty _Value; // the stored value
+};
+
+// CLASS TEMPLATE mpsc_queue
+template <class _Ty>
+class mpsc_queue { // non-throwing lock-free multi-producer/single-consumer queue
+private:
+    using _Alloc  = allocator<void>;
+    using _Node_t = _Mpsc_queue_node<_Ty>;
+
+public:
+    using value_type      = _Ty;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+    using pointer         = _Ty*;
+    using const_pointer   = const _Ty*;
+    using reference       = _Ty&;
+    using const_reference = const _Ty&;
+
+    // Note: Producers append a node by exchanging _Mytail and then linking the previous tail
+    //       to it (D. Vyukov's algorithm), so they never wait for each other or for the consumer.
+    //       _Myhead always points to a dummy node (initially _Mystub), whose successor is the front.
+    //       push() may be called by any thread. pop(), pop_many() and clear() must be called
+    //       by one thread at a time (the consumer).
+    mpsc_queue() noexcept : _Mystub(), _Myhead(_TPLMGR addressof(_Mystub)),
+        _Mytail(_TPLMGR addressof(_Mystub)), _Mysize(0) {}
+
+    mpsc_queue(mpsc_queue&& _Other) noexcept : _Mystub(), _Myhead(_TPLMGR addressof(_Mystub)),
+        _Mytail(_TPLMGR addressof(_Mystub)), _Mysize(0) {
+        _Take(_Other);
+    }
+
+    ~mpsc_queue() noexcept {
+        clear();
+        _Free_node(_Myhead);
+    }
+
+    mpsc_queue& operator=(mpsc_queue&& _Other) noexcept {
+        if (this != _TPLMGR addressof(_Other)) {
+            clear();
+            _Take(_Other);
+        }
+
+        return *this;
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    // checks if the queue is empty (a value that is being pushed counts as pushed)
+    bool empty() const noexcept {
+        return _Mysize.load(_STD memory_order_acquire) == 0;
+    }
+
+    // returns the number of values (a value that is being pushed counts as pushed)
+    size_type size() const noexcept {
+        return _Mysize.load(_STD memory_order_relaxed);
+    }
+
+    size_type max_size() const noexcept {
+        return static_cast<size_type>(-1) / sizeof(_Node_t);
+    }
+
+    _NODISCARD_ATTR bool push(const value_type& _Val) noexcept {
+        _Node_t* const _Node = _Allocate_node(_Val);
+        if (!_Node) { // allocation failed
+            return false;
+        }
+
+        _Link(_Node, _Node, 1);
+        return true;
+    }
+
+    _NODISCARD_ATTR bool push(value_type&& _Val) noexcept {
+        _Node_t* const _Node = _Allocate_node(_STD move(_Val));
+        if (!_Node) { // allocation failed
+            return false;
+        }
+
+        _Link(_Node, _Node, 1);
+        return true;
+    }
+
+    // pushes _Src[0], ..., _Src[_Count - 1] with a single exchange, returns the number of pushed values
+    template <class _Source>
+    size_type push_many(const _Source& _Src, const size_type _Count) noexcept {
+        if (_Count == 0) {
+            return 0;
+        }
+
+        _Node_t* const _First = _Allocate_node(_Src[0]);
+        if (!_First) { // allocation failed
+            return 0;
+        }
+
+        _Node_t* _Last    = _First;
+        size_type _Pushed = 1;
+        for (; _Pushed < _Count; ++_Pushed) { // build the chain privately, then publish it at once
+            _Node_t* const _Node = _Allocate_node(_Src[_Pushed]);
+            if (!_Node) { // allocation failed, push what is already allocated
+                break;
+            }
+
+            _Last->_Next.store(_Node, _STD memory_order_relaxed);
+            _Last = _Node;
+        }
+
+        _Link(_First, _Last, _Pushed);
+        return _Pushed;
+    }
+
+    // tries to pop the front value (consumer only)
+    _NODISCARD_ATTR bool pop(value_type& _Val) noexcept {
+        _Node_t* const _Head = _Myhead;
+        _Node_t* const _Next = _Head->_Next.load(_STD memory_order_acquire);
+        if (!_Next) { // empty (or the front value is not linked yet)
+            return false;
+        }
+
+        _Val    = _STD move(_Next->_Value);
+        _Myhead = _Next; // the popped node becomes the dummy one
+        _Free_node(_Head);
+        _Mysize.fetch_sub(1, _STD memory_order_relaxed);
+        return true;
+    }
+
+    // pops up to _Count values, returns the number of popped values (consumer only)
+    size_type pop_many(value_type* const _Dest, const size_type _Count) noexcept {
+        size_type _Popped = 0;
+        while (_Popped < _Count && pop(_Dest[_Popped])) {
+            ++_Popped;
+        }
+
+        return _Popped;
+    }
+
+    // pops all linked values, returns the number of popped values (consumer only)
+    size_type clear() noexcept {
+        size_type _Popped = 0;
+        value_type _Val;
+        while (pop(_Val)) {
+            ++_Popped;
+        }
+
+        return _Popped;
+    }
+
+private:
+    template <class _Valty>
+    _Node_t* _Allocate_node(_Valty&& _Val) noexcept {
+        _Alloc _Al;
+        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        return _Raw ? ::new (_Raw) _Node_t(_STD forward<_Valty>(_Val)) : nullptr;
+    }
+
+    void _Free_node(_Node_t* const _Node) noexcept {
+        if (_Node != _TPLMGR addressof(_Mystub)) { // the stub is not allocated
+            _Alloc _Al;
+            _Node->~_Node_t();
+            _Al.deallocate(_Node, sizeof(_Node_t));
+        }
+    }
+
+    void _Link(_Node_t* const _First, _Node_t* const _Last, const size_type _Count) noexcept {
+        // Note: The size is incremented first, so it never underflows when the consumer pops
+        //       the values before the increment would become visible.
+        _Mysize.fetch_add(_Count, _STD memory_order_relaxed);
+        _Node_t* const _Prev = _Mytail.exchange(_Last, _STD memory_order_acq_rel);
+        _Prev->_Next.store(_First, _STD memory_order_release);
+    }
+
+    void _Take(mpsc_queue& _Other) noexcept { // neither queue may be used meanwhile
+        _Node_t* const _First = _Other._Myhead->_Next.load(_STD memory_order_relaxed);
+        if (!_First) { // nothing to take
+            return;
+        }
+
+        _Node_t* const _Last = _Other._Mytail.load(_STD memory_order_relaxed);
+        _Other._Free_node(_Other._Myhead);
+        _Other._Mystub._Next.store(nullptr, _STD memory_order_relaxed);
+        _Other._Myhead = _TPLMGR addressof(_Other._Mystub);
+        _Other._Mytail.store(_TPLMGR addressof(_Other._Mystub), _STD memory_order_relaxed);
+        _Link(_First, _Last, _Other._Mysize.exchange(0, _STD memory_order_relaxed));
+    }
+
+    _Node_t _Mystub; // the initial dummy node
+    _Node_t* _Myhead; // the dummy node, used only by the consumer
+    char _Mypad[_Cache_line_size]; // keep producers off the consumer's line
+    atomic<_Node_t*> _Mytail; // the most recently pushed node
+    atomic<size_type> _Mysize;
+};
+
+// CLASS TEMPLATE _Mpsc_priority_queue
+template <class _Ty, size_t _Levels>
+class _Mpsc_priority_queue { // one lock-free MPSC queue per priority level (higher level first)
+private:
+    static_assert(_Levels > 0, "The number of levels must be greater than 0.");
+
+    using _Level_t = mpsc_queue<_Ty>;
+
+public:
+    using value_type = _Ty;
+    using size_type  = size_t;
+
+    static constexpr size_type levels = _Levels;
+
+    // Note: Producers never lock. Consumers (the owning thread and rare operations such as clear())
+    //       are serialized by _Mylock, which producers never touch.
+    _Mpsc_priority_queue() noexcept : _Mylevels(), _Mylock() {}
+
+    _Mpsc_priority_queue(_Mpsc_priority_queue&& _Other) noexcept : _Mylevels(), _Mylock() {
+        lock_guard _Guard(_Other._Mylock);
+        for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+            _Mylevels[_Level] = _STD move(_Other._Mylevels[_Level]);
+        }
+    }
+
+    ~_Mpsc_priority_queue() noexcept {}
+
+    _Mpsc_priority_queue& operator=(_Mpsc_priority_queue&& _Other) noexcept {
+        if (this != _TPLMGR addressof(_Other)) {
+            lock_guard _Guard(_Mylock);
+            lock_guard _Other_guard(_Other._Mylock);
+            for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+                _Mylevels[_Level] = _STD move(_Other._Mylevels[_Level]);
+            }
+        }
+
+        return *this;
+    }
+
+    _Mpsc_priority_queue(const _Mpsc_priority_queue&) = delete;
+    _Mpsc_priority_queue& operator=(const _Mpsc_priority_queue&) = delete;
+
+    size_type clear() noexcept { // returns the number of removed values
+        lock_guard _Guard(_Mylock);
+        size_type _Cleared = 0;
+        for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+            _Cleared += _Mylevels[_Level].clear();
+        }
+
+        return _Cleared;
+    }
+
+    bool empty() const noexcept {
+        for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+            if (!_Mylevels[_Level].empty()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    size_type size() const noexcept {
+        size_type _Size = 0;
+        for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+            _Size += _Mylevels[_Level].size();
+        }
+
+        return _Size;
+    }
+
+    size_type approximate_size() const noexcept { // doesn't lock
+        return size();
+    }
+
+    bool full() const noexcept {
+        return size() >= max_size();
+    }
+
+    size_type max_size() const noexcept {
+        return _Mylevels[0].max_size();
+    }
+
+    _NODISCARD_ATTR bool push(const value_type& _Val, const size_type _Level) noexcept {
+        return _Level < _Levels ? _Mylevels[_Level].push(_Val) : false;
+    }
+
+    _NODISCARD_ATTR bool push(value_type&& _Val, const size_type _Level) noexcept {
+        return _Level < _Levels ? _Mylevels[_Level].push(_STD move(_Val)) : false;
+    }
+
+    template <class _Source>
+    size_type push_many(const _Source& _Src, const size_type _Count, const size_type _Level) noexcept {
+        return _Level < _Levels ? _Mylevels[_Level].push_many(_Src, _Count) : 0;
+    }
+
+    size_type pop_many(value_type* const _Dest, const size_type _Count) noexcept {
+        lock_guard _Guard(_Mylock);
+        size_type _Popped = 0;
+        for (size_type _Level = _Levels; _Level-- > 0 && _Popped < _Count;) { // highest level first
+            _Popped += _Mylevels[_Level].pop_many(_Dest + _Popped, _Count - _Popped);
+        }
+
+        return _Popped;
+    }
+
+private:
+    _Level_t _Mylevels[_Levels];
+    shared_lock _Mylock;
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_MPSC_QUEUE_HPP_
\ No newline at end of file
@@ -0,0 +1,302 @@
+// parallel_for.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_PARALLEL_FOR_HPP_
+#define _TPLMGR_PARALLEL_FOR_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/thread.hpp>
+#include <tplmgr/thread_pool.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// CONSTANT _Default_chunks_per_thread
+_INLINE_VARIABLE constexpr uint64_t _Default_chunks_per_thread = 16; // used if no grain size is given
+
+// STRUCT _Parallel_slot
+struct alignas(_Cache_line_size) _Parallel_slot { // chunks owned by one participant
+    // Note: The lower 32 bits hold the first chunk, the upper 32 bits hold the end of the range.
+    //       The owner takes chunks from the front, idle participants steal half from the back.
+    atomic<uint64_t> _Range;
+};
+
+// CLASS TEMPLATE _Parallel_loop
+template <class _Ty, class _Fn>
+class _Parallel_loop { // shared state of a single parallel_for() call
+public:
+    using _Uty = _STD make_unsigned_t<_Ty>;
+
+    enum : uint32_t {
+        _Done       = 0x1, // all chunks have been performed
+        _Has_waiter = 0x2 // the calling thread is blocked
+    };
+
+    _Parallel_loop(const _Ty _First, const uint64_t _Size, const uint64_t _Grain, const uint32_t _Chunks,
+        const uint32_t _Helpers, _Fn& _Body, const size_t _Bytes) noexcept
+        : _Myfirst(_First), _Mysize(_Size), _Mygrain(_Grain), _Mybody(_TPLMGR addressof(_Body)),
+          _Myremaining(_Chunks), _Mystate(0), _Myjoined(1), _Myrefs(_Helpers + 1), _Myslot_count(_Helpers + 1),
+          _Mybytes(_Bytes), _Myslots(nullptr), _Mydata(nullptr) {}
+
+    _Parallel_loop(const _Parallel_loop&) = delete;
+    _Parallel_loop& operator=(const _Parallel_loop&) = delete;
+
+    // tries to allocate the state, the slots and the helpers' data at once, returns null on failure
+    static _Parallel_loop* _Create(const _Ty _First, const uint64_t _Size, const uint64_t _Grain,
+        const uint32_t _Chunks, const uint32_t _Helpers, _Fn& _Body) noexcept {
+        constexpr size_t _Slots_offset = (sizeof(_Parallel_loop) + _Cache_line_size - 1) & ~(_Cache_line_size - 1);
+        const size_t _Data_offset      = _Slots_offset + (size_t{_Helpers} + 1) * sizeof(_Parallel_slot);
+        const size_t _Bytes            = _Data_offset + size_t{_Helpers} * sizeof(void*);
+        void* const _Raw               = allocator_traits::allocate(_Bytes, _Cache_line_size);
+        if (!_Raw) { // allocation failed
+            return nullptr;
+        }
+
+        _Parallel_loop* const _Loop =
+            ::new (_Raw) _Parallel_loop(_First, _Size, _Grain, _Chunks, _Helpers, _Body, _Bytes);
+        _Loop->_Myslots = reinterpret_cast<_Parallel_slot*>(static_cast<char*>(_Raw) + _Slots_offset);
+        _Loop->_Mydata  = reinterpret_cast<void**>(static_cast<char*>(_Raw) + _Data_offset);
+        ::new (static_cast<void*>(_Loop->_Myslots)) _Parallel_slot{{uint64_t{_Chunks} << 32}}; // all chunks
+        for (uint32_t _Idx = 1; _Idx <= _Helpers; ++_Idx) {
+            ::new (static_cast<void*>(_Loop->_Myslots + _Idx)) _Parallel_slot{{0}};
+            _Loop->_Mydata[_Idx - 1] = _Loop;
+        }
+
+        return _Loop;
+    }
+
+    // schedules the helpers, the ones that couldn't be scheduled are released
+    void _Schedule_helpers(thread_pool& _Pool) noexcept {
+        const uint32_t _Helpers = _Myslot_count - 1;
+        const size_t _Scheduled = _Pool.schedule_tasks(&_Run_helper, _Mydata, _Helpers);
+        if (_Scheduled < _Helpers) {
+            _Release(static_cast<uint32_t>(_Helpers - _Scheduled));
+        }
+    }
+
+    // performs chunks until none is left, then waits for the ones performed by other threads
+    void _Run_and_wait() noexcept {
+        _Participate(0);
+
+        // Note: The remaining chunks are being performed right now, so the wait is usually short.
+        for (uint32_t _Spins = 0;;) {
+            uint32_t _State = _Mystate.load(_STD memory_order_acquire);
+            if (_State & _Done) {
+                break;
+            }
+
+            if (_Spins < _Default_spin_count) {
+                ++_Spins;
+                _Yield_processor();
+                continue;
+            }
+
+            if (!(_State & _Has_waiter)) { // tell the last participant to wake this thread
+                if (!_Mystate.compare_exchange_weak(_State, _State | _Has_waiter, _STD memory_order_acquire)) {
+                    continue;
+                }
+
+                _State |= _Has_waiter;
+            }
+
+            _Wait_on_address(_Mystate, _State);
+        }
+
+        _Release(1);
+    }
+
+    void _Release(const uint32_t _Count) noexcept {
+        if (_Myrefs.fetch_sub(_Count, _STD memory_order_acq_rel) == _Count) { // the last owner
+            const size_t _Bytes = _Mybytes;
+            this->~_Parallel_loop();
+            allocator_traits::deallocate(this, _Bytes, _Cache_line_size);
+        }
+    }
+
+private:
+    static void __STDCALL_OR_CDECL _Run_helper(void* const _Data) {
+        // Note: A helper that runs after all chunks have been taken doesn't touch the body,
+        //       which may no longer exist once the calling thread has returned.
+        _Parallel_loop* const _Loop = static_cast<_Parallel_loop*>(_Data);
+        const uint32_t _Slot        = _Loop->_Myjoined.fetch_add(1, _STD memory_order_relaxed);
+        if (_Slot < _Loop->_Myslot_count) {
+            _Loop->_Participate(_Slot);
+        }
+
+        _Loop->_Release(1);
+    }
+
+    // performs chunks from the participant's slot, steals more once it's empty
+    void _Participate(const uint32_t _Slot) noexcept {
+        uint32_t _Chunk;
+        uint32_t _Performed = 0;
+        for (;;) {
+            if (_Take_chunk(_Slot, _Chunk)) {
+                _Run_chunk(_Chunk);
+                ++_Performed;
+                continue;
+            }
+
+            if (_Performed > 0) { // report the performed chunks before looking for more
+                _Finish_chunks(_Performed);
+                _Performed = 0;
+            }
+
+            if (!_Steal_chunks(_Slot)) { // nothing left to steal
+                return;
+            }
+        }
+    }
+
+    // tries to take the first chunk from the participant's own slot
+    bool _Take_chunk(const uint32_t _Slot, uint32_t& _Chunk) noexcept {
+        atomic<uint64_t>& _Range = _Myslots[_Slot]._Range;
+        uint64_t _Old            = _Range.load(_STD memory_order_relaxed);
+        for (;;) {
+            const uint32_t _Low  = static_cast<uint32_t>(_Old);
+            const uint32_t _High = static_cast<uint32_t>(_Old >> 32);
+            if (_Low >= _High) { // the slot is empty
+                return false;
+            }
+
+            if (_Range.compare_exchange_weak(_Old, _Old + 1, _STD memory_order_acq_rel)) {
+                _Chunk = _Low;
+                return true;
+            }
+        }
+    }
+
+    // tries to steal the back half of the fullest slot into the participant's own (empty) slot
+    bool _Steal_chunks(const uint32_t _Slot) noexcept {
+        // Note: The range is split only here, i.e. only if some participant has run out of work,
+        //       so a loop that is evenly balanced doesn't pay for splitting.
+        for (;;) {
+            uint32_t _Victim  = _Myslot_count;
+            uint64_t _Old     = 0;
+            uint32_t _Longest = 0;
+            for (uint32_t _Idx = 0; _Idx < _Myslot_count; ++_Idx) {
+                if (_Idx == _Slot) {
+                    continue;
+                }
+
+                const uint64_t _Range = _Myslots[_Idx]._Range.load(_STD memory_order_relaxed);
+                const uint32_t _Low   = static_cast<uint32_t>(_Range);
+                const uint32_t _High  = static_cast<uint32_t>(_Range >> 32);
+                if (_High > _Low && _High - _Low > _Longest) {
+                    _Victim  = _Idx;
+                    _Old     = _Range;
+                    _Longest = _High - _Low;
+                }
+            }
+
+            if (_Victim == _Myslot_count) { // all chunks have been taken
+                return false;
+            }
+
+            const uint32_t _High  = static_cast<uint32_t>(_Old >> 32);
+            const uint32_t _Split = _High - (_Longest + 1) / 2; // the victim keeps the smaller half
+            const uint64_t _New   = (_Old & 0xFFFF'FFFF) | (uint64_t{_Split} << 32);
+            if (_Myslots[_Victim]._Range.compare_exchange_weak(_Old, _New, _STD memory_order_acq_rel)) {
+                _Myslots[_Slot]._Range.store(_Split | (uint64_t{_High} << 32), _STD memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    void _Run_chunk(const uint32_t _Chunk) {
+        const uint64_t _First = _Chunk * _Mygrain;
+        const uint64_t _Last  = _Mysize - _First > _Mygrain ? _First + _Mygrain : _Mysize;
+        for (uint64_t _Idx = _First; _Idx < _Last; ++_Idx) {
+            (*_Mybody)(static_cast<_Ty>(static_cast<_Uty>(static_cast<_Uty>(_Myfirst) + static_cast<_Uty>(_Idx))));
+        }
+    }
+
+    void _Finish_chunks(const uint32_t _Count) noexcept {
+        if (_Myremaining.fetch_sub(_Count, _STD memory_order_acq_rel) == _Count) { // the last chunk
+            if (_Mystate.fetch_or(_Done, _STD memory_order_release) & _Has_waiter) {
+                _Wake_by_address_all(_Mystate);
+            }
+        }
+    }
+
+    _Ty _Myfirst;
+    uint64_t _Mysize; // number of indices
+    uint64_t _Mygrain; // number of indices per chunk
+    _Fn* _Mybody;
+    atomic<uint32_t> _Myremaining; // chunks that haven't been performed yet
+    atomic<uint32_t> _Mystate;
+    atomic<uint32_t> _Myjoined; // the next free slot
+    atomic<uint32_t> _Myrefs; // the calling thread and the helpers that haven't finished yet
+    uint32_t _Myslot_count;
+    size_t _Mybytes; // size of the whole allocation
+    _Parallel_slot* _Myslots;
+    void** _Mydata; // data of each helper (the state itself)
+};
+
+// FUNCTION TEMPLATE _Parallel_for
+template <class _Ty, class _Fn>
+void _Parallel_for(thread_pool& _Pool, const _Ty _First, const _Ty _Last, uint64_t _Grain, _Fn& _Body) noexcept {
+    using _Uty = _STD make_unsigned_t<_Ty>;
+    if (!(_First < _Last)) { // nothing to do
+        return;
+    }
+
+    const uint64_t _Size    = static_cast<_Uty>(static_cast<_Uty>(_Last) - static_cast<_Uty>(_First));
+    const uint64_t _Threads = _Pool.threads();
+    if (_Grain == 0) { // about _Default_chunks_per_thread chunks for each participant
+        _Grain = (_Size + (_Threads + 1) * _Default_chunks_per_thread - 1) / ((_Threads + 1) * _Default_chunks_per_thread);
+    }
+
+    if (_Size / _Grain >= UINT32_MAX) { // the chunk index must fit in 32 bits
+        _Grain = _Size / (UINT32_MAX - 1) + 1;
+    }
+
+    const uint64_t _Chunks  = _Size / _Grain + (_Size % _Grain != 0 ? 1 : 0);
+    const uint64_t _Helpers = _Chunks - 1 < _Threads ? _Chunks - 1 : _Threads;
+    _Parallel_loop<_Ty, _Fn>* const _Loop =
+        _Helpers > 0 ? _Parallel_loop<_Ty, _Fn>::_Create(_First, _Size, _Grain, static_cast<uint32_t>(_Chunks),
+            static_cast<uint32_t>(_Helpers), _Body) : nullptr;
+    if (!_Loop) { // a single chunk, no threads or the allocation failed, perform it serially
+        for (_Ty _Idx = _First; _Idx != _Last; ++_Idx) {
+            _Body(_Idx);
+        }
+
+        return;
+    }
+
+    _Loop->_Schedule_helpers(_Pool);
+    _Loop->_Run_and_wait();
+}
+
+// FUNCTION TEMPLATE parallel_for
+template <class _Ty, class _Fn>
+void parallel_for(thread_pool& _Pool, const _Ty _First, const _Ty _Last, _Fn&& _Body) noexcept {
+    // Note: _Body(_First), ..., _Body(_Last - 1) are invoked concurrently on the same object,
+    //       the calling thread performs some of them as well and returns once all have finished.
+    static_assert(_STD is_integral_v<_Ty>, "parallel_for() requires an integral index type");
+    _TPLMGR _Parallel_for(_Pool, _First, _Last, 0, _Body);
+}
+
+template <class _Ty, class _Fn>
+void parallel_for(thread_pool& _Pool, const _Ty _First, const _Ty _Last, const size_t _Grain, _Fn&& _Body) noexcept {
+    // Note: Indices are taken in chunks of _Grain (the last chunk may be smaller),
+    //       a chunk is never split, so _Grain should cover at least a few microseconds of work.
+    static_assert(_STD is_integral_v<_Ty>, "parallel_for() requires an integral index type");
+    _TPLMGR _Parallel_for(_Pool, _First, _Last, _Grain > 0 ? _Grain : 1, _Body);
+}
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_PARALLEL_FOR_HPP_
\ No newline at end of file
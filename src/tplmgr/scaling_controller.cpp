@@ -0,0 +1,185 @@
+// scaling_controller.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <tplmgr/tplmgr_pch.hpp>
+#include <tplmgr/scaling_controller.hpp>
+#include <tplmgr/thread_pool.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+
+_TPLMGR_BEGIN
+// FUNCTION _Scaling_controller constructor/destructor
+_Scaling_controller::_Scaling_controller(thread_pool& _Pool) noexcept
+    : _Mypool(_TPLMGR addressof(_Pool)), _Mycontrol_lock(), _Mylock(), _Myoptions{1, 1, 0, 0},
+    _Mythread(nullptr), _Mythread_id(0), _Mystopped(false), _Mychanged(false), _Mysignal(0), _Mylast_tick(0),
+    _Mylast_completed(0), _Mythroughput(0), _Mybase_size(0), _Myceiling(1), _Myhold(0), _Mygrew(false) {}
+
+_Scaling_controller::~_Scaling_controller() noexcept {
+    _Stop();
+}
+
+// FUNCTION _Scaling_controller::_Controller_handler
+unsigned long __stdcall _Scaling_controller::_Controller_handler(void* const _Data) noexcept {
+    static_cast<_Scaling_controller*>(_Data)->_Run();
+    return 0;
+}
+
+// FUNCTION _Scaling_controller::_Reset
+void _Scaling_controller::_Reset(const scaling_options& _Options) noexcept {
+    _Mylast_tick      = 0;
+    _Mylast_completed = 0;
+    _Mythroughput     = 0;
+    _Mybase_size      = 0;
+    _Myceiling        = _Options.max_threads;
+    _Myhold           = 0;
+    _Mygrew           = false;
+}
+
+// FUNCTION _Scaling_controller::_Run
+void _Scaling_controller::_Run() noexcept {
+    for (;;) {
+        scaling_options _Options;
+        uint32_t _Signal = 0;
+        {
+            lock_guard _Guard(_Mylock);
+            if (_Mystopped) { // the controller is being stopped
+                return;
+            }
+
+            _Signal  = _Mysignal.load(_STD memory_order_relaxed);
+            _Options = _Myoptions;
+            if (_Mychanged) { // previous measurements were made with other bounds
+                _Mychanged = false;
+                _Reset(_Options);
+            }
+        }
+
+        _Adjust(_Options);
+        (void) _Wait_on_address_for(_Mysignal, _Signal, _Options.interval);
+    }
+}
+
+// FUNCTION _Scaling_controller::_Adjust
+void _Scaling_controller::_Adjust(const scaling_options& _Options) noexcept {
+    if (!_Mypool->is_working()) { // suspended or closed, the throughput means nothing
+        _Mylast_tick = 0;
+        _Mygrew      = false;
+        return;
+    }
+
+    const _Scaling_sample _Sample = _Mypool->_Sample();
+    const uint64_t _Now           = _Tick_count();
+    size_t _Size                  = _Sample._Threads;
+    if (_Size < _Options.min_threads) { // hire the missing threads immediately
+        (void) _Mypool->increase_threads(_Options.min_threads - _Size);
+        return;
+    }
+
+    // Note: Only waiting threads without pending tasks are dismissed, so no task is ever
+    //       discarded. Threads above max_threads go as soon as they are idle, the other ones
+    //       once they have been idle for keep_alive milliseconds.
+    if (_Size > _Options.max_threads) {
+        _Size -= _Mypool->_Dismiss_idle_threads(_Size - _Options.max_threads, _Now);
+    }
+
+    if (_Size > _Options.min_threads && _Now >= _Options.keep_alive) {
+        _Size -= _Mypool->_Dismiss_idle_threads(_Size - _Options.min_threads, _Now - _Options.keep_alive);
+    }
+
+    if (_Mylast_tick == 0 || _Now <= _Mylast_tick) { // the first sample, nothing to compare with
+        _Mylast_tick      = _Now;
+        _Mylast_completed = _Sample._Completed_tasks;
+        _Mygrew           = false;
+        return;
+    }
+
+    const uint64_t _Elapsed    = _Now - _Mylast_tick;
+    const uint64_t _Done       = _Sample._Completed_tasks - _Mylast_completed;
+    const uint64_t _Throughput = _Done * 1000 / _Elapsed; // tasks per second
+    _Mylast_tick               = _Now;
+    _Mylast_completed          = _Sample._Completed_tasks;
+    if (_Mygrew) { // keep growing only if the last growth has paid off (by more than 1/16)
+        _Mygrew = false;
+        if (_Throughput <= _Mythroughput + _Mythroughput / 16) {
+            _Myceiling = _Mybase_size;
+            _Myhold    = _Hold_intervals;
+        }
+    } else if (_Myhold > 0 && --_Myhold == 0) { // the load may have changed, try growing again
+        _Myceiling = _Options.max_threads;
+    }
+
+    // Note: Tasks wait only if no thread is idle and there are more outstanding tasks than busy
+    //       threads. By Little's law, the average wait is the number of waiting tasks divided by
+    //       the rate at which they are taken, which is the measured throughput.
+    const size_t _Busy = _Sample._Threads - (_STD min)(_Sample._Idle_threads, _Sample._Threads);
+    if (_Sample._Idle_threads > 0 || _Sample._Outstanding_tasks <= _Busy) { // no task waits
+        return;
+    }
+
+    const uint64_t _Waiting = _Sample._Outstanding_tasks - _Busy;
+    if (_Done > 0 && _Waiting * _Elapsed / _Done <= _Options.interval) { // tasks don't wait long
+        return;
+    }
+
+    const size_t _Limit = (_STD min)(_Myceiling, _Options.max_threads);
+    if (_Size >= _Limit) { // more threads are not allowed or haven't helped
+        return;
+    }
+
+    const size_t _Count = (_STD min)((_STD max)(_Size / 4, size_t{1}), _Limit - _Size);
+    if (_Mypool->increase_threads(_Count)) {
+        _Mythroughput = _Throughput;
+        _Mybase_size  = _Size;
+        _Mygrew       = true;
+    }
+}
+
+// FUNCTION _Scaling_controller::_Start
+_NODISCARD_ATTR bool _Scaling_controller::_Start(const scaling_options& _Options) noexcept {
+    lock_guard _Control_guard(_Mycontrol_lock);
+    lock_guard _Guard(_Mylock);
+    _Myoptions = _Options;
+    if (_Mythread) { // already running, let it adjust the pool with the new options
+        _Mychanged = true;
+        _Mysignal.fetch_add(1, _STD memory_order_relaxed);
+        _Wake_by_address_single(_Mysignal);
+        return true;
+    }
+
+    _Reset(_Options);
+    _Mystopped = false;
+    _Mychanged = false;
+    _Mythread  = _Create_thread(&_Controller_handler, this, _TPLMGR addressof(_Mythread_id));
+    return _Mythread != nullptr;
+}
+
+// FUNCTION _Scaling_controller::_Stop
+void _Scaling_controller::_Stop() noexcept {
+    lock_guard _Control_guard(_Mycontrol_lock);
+    {
+        lock_guard _Guard(_Mylock);
+        if (!_Mythread) { // not running
+            return;
+        }
+
+        _Mystopped = true;
+        _Mysignal.fetch_add(1, _STD memory_order_relaxed);
+        _Wake_by_address_single(_Mysignal);
+    }
+
+    _Wait_for_thread(_Mythread); // the controller thread doesn't take _Mycontrol_lock
+    _Close_thread(_Mythread);
+    lock_guard _Guard(_Mylock);
+    _Mythread    = nullptr;
+    _Mythread_id = 0;
+}
+
+// FUNCTION _Scaling_controller::_Running
+bool _Scaling_controller::_Running() const noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    return _Mythread != nullptr && !_Mystopped;
+}
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
\ No newline at end of file
@@ -0,0 +1,96 @@
+// scaling_controller.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_SCALING_CONTROLLER_HPP_
+#define _TPLMGR_SCALING_CONTROLLER_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/thread.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// STRUCT scaling_options
+struct scaling_options {
+    size_t min_threads; // the pool never shrinks below this number of threads
+    size_t max_threads; // the pool never grows above this number of threads
+    uint32_t keep_alive; // milliseconds after which an idle thread above min_threads is dismissed
+    uint32_t interval; // milliseconds between two adjustments
+};
+
+// STRUCT _Scaling_sample
+struct _Scaling_sample { // state of the pool observed by the controller
+    size_t _Threads;
+    size_t _Idle_threads;
+    size_t _Outstanding_tasks; // scheduled, but not finished yet (pending or running)
+    uint64_t _Completed_tasks; // since the pool was created
+};
+
+// CLASS thread_pool
+class thread_pool;
+
+// CLASS _Scaling_controller
+class _Scaling_controller { // adjusts the number of threads, runs on its own thread
+public:
+    explicit _Scaling_controller(thread_pool& _Pool) noexcept;
+    ~_Scaling_controller() noexcept;
+
+    _Scaling_controller(const _Scaling_controller&) = delete;
+    _Scaling_controller& operator=(const _Scaling_controller&) = delete;
+
+    // tries to start the controller thread, only replaces the options if it's already running
+    _NODISCARD_ATTR bool _Start(const scaling_options& _Options) noexcept;
+
+    // stops the controller thread, the number of threads stays as it is
+    void _Stop() noexcept;
+
+    // checks if the controller thread is running
+    bool _Running() const noexcept;
+
+private:
+    static constexpr uint32_t _Hold_intervals = 8; // intervals for which a failed growth is not repeated
+
+    static unsigned long __stdcall _Controller_handler(void* const _Data) noexcept;
+
+    // adjusts the pool once per interval until stopped
+    void _Run() noexcept;
+
+    // samples the pool, dismisses idle threads and hires new ones if tasks wait too long
+    void _Adjust(const scaling_options& _Options) noexcept;
+
+    // forgets the previous sample, the next adjustment only measures
+    void _Reset(const scaling_options& _Options) noexcept;
+
+    // Note: The controller estimates how long tasks wait in the queues from the number of
+    //       pending tasks and the measured throughput (Little's law), so tasks don't have to
+    //       carry timestamps. A growth is kept only if the throughput has risen, otherwise
+    //       the previous size becomes the ceiling for _Hold_intervals (hill climbing).
+    thread_pool* _Mypool;
+    shared_lock _Mycontrol_lock; // serializes _Start() and _Stop(), never taken by the controller thread
+    mutable shared_lock _Mylock; // guards the options and the flags shared with the controller thread
+    scaling_options _Myoptions;
+    void* _Mythread;
+    unsigned int _Mythread_id;
+    bool _Mystopped;
+    bool _Mychanged; // the options have been replaced, the controller thread must start over
+    atomic<uint32_t> _Mysignal; // changed to wake the controller thread
+    uint64_t _Mylast_tick; // tick of the previous sample, 0 if there is none
+    uint64_t _Mylast_completed; // completed tasks at the previous sample
+    uint64_t _Mythroughput; // tasks per second before the last growth
+    size_t _Mybase_size; // number of threads before the last growth
+    size_t _Myceiling; // the controller doesn't grow the pool above this number of threads
+    uint32_t _Myhold; // remaining intervals until _Myceiling is reset
+    bool _Mygrew; // the previous adjustment hired some threads
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_SCALING_CONTROLLER_HPP_
\ No newline at end of file
@@ -6,8 +6,96 @@
 #include <tplmgr/tplmgr_pch.hpp>
 #include <tplmgr/shared_lock.hpp>
 #if _TPLMGR_PREPROCESSOR_GUARD
+#ifdef _MSC_VER
+#pragma comment(lib, "Synchronization.lib") // WaitOnAddress() and WakeByAddress*()
+#endif // _MSC_VER
 
 _TPLMGR_BEGIN
+#ifndef _WIN32
+// FUNCTION _Futex
+static long _Futex(atomic<uint32_t>& _Word, const int _Op, const uint32_t _Val,
+    const timespec* const _Timeout = nullptr) noexcept {
+    // Note: std::atomic<uint32_t> is guaranteed to have the same layout as uint32_t.
+    return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(_TPLMGR addressof(_Word)),
+        _Op | FUTEX_PRIVATE_FLAG, _Val, _Timeout, nullptr, 0);
+}
+#endif // _WIN32
+
+// FUNCTION _Wait_on_address
+void _Wait_on_address(atomic<uint32_t>& _Word, const uint32_t _Expected) noexcept {
+#ifdef _WIN32
+    uint32_t _Compare = _Expected;
+    ::WaitOnAddress(_TPLMGR addressof(_Word), _TPLMGR addressof(_Compare), sizeof(uint32_t), INFINITE);
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    (void) _Futex(_Word, FUTEX_WAIT, _Expected); // may return spuriously, the caller must recheck
+#endif // _WIN32
+}
+
+// FUNCTION _Wait_on_address_for
+bool _Wait_on_address_for(
+    atomic<uint32_t>& _Word, const uint32_t _Expected, const uint32_t _Milliseconds) noexcept {
+    // Note: Returns false if the time is out, otherwise the caller must recheck the value.
+#ifdef _WIN32
+    uint32_t _Compare = _Expected;
+    return ::WaitOnAddress(_TPLMGR addressof(_Word), _TPLMGR addressof(_Compare), sizeof(uint32_t), _Milliseconds)
+        || ::GetLastError() != ERROR_TIMEOUT;
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    const timespec _Timeout = {static_cast<time_t>(_Milliseconds / 1000),
+        static_cast<long>(_Milliseconds % 1000) * 1'000'000L}; // relative to now
+    return _Futex(_Word, FUTEX_WAIT, _Expected, _TPLMGR addressof(_Timeout)) == 0 || errno != ETIMEDOUT;
+#endif // _WIN32
+}
+
+// FUNCTION _Tick_count
+uint64_t _Tick_count() noexcept { // milliseconds since an unspecified point (monotonic)
+#ifdef _WIN32
+    return ::GetTickCount64();
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    timespec _Now;
+    ::clock_gettime(CLOCK_MONOTONIC, _TPLMGR addressof(_Now));
+    return static_cast<uint64_t>(_Now.tv_sec) * 1000 + static_cast<uint64_t>(_Now.tv_nsec) / 1'000'000;
+#endif // _WIN32
+}
+
+// FUNCTION _Precise_tick_count
+uint64_t _Precise_tick_count() noexcept { // nanoseconds since an unspecified point (monotonic)
+#ifdef _WIN32
+    static const uint64_t _Frequency = [] {
+        LARGE_INTEGER _Value;
+        ::QueryPerformanceFrequency(_TPLMGR addressof(_Value)); // never fails since Windows XP
+        return static_cast<uint64_t>(_Value.QuadPart);
+    }();
+
+    LARGE_INTEGER _Now;
+    ::QueryPerformanceCounter(_TPLMGR addressof(_Now));
+    const uint64_t _Ticks = static_cast<uint64_t>(_Now.QuadPart);
+    return _Ticks / _Frequency * 1'000'000'000 + _Ticks % _Frequency * 1'000'000'000 / _Frequency;
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    timespec _Now;
+    ::clock_gettime(CLOCK_MONOTONIC, _TPLMGR addressof(_Now));
+    return static_cast<uint64_t>(_Now.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(_Now.tv_nsec);
+#endif // _WIN32
+}
+
+// FUNCTION _Wake_by_address_single
+void _Wake_by_address_single(atomic<uint32_t>& _Word) noexcept {
+#ifdef _WIN32
+    ::WakeByAddressSingle(_TPLMGR addressof(_Word));
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    (void) _Futex(_Word, FUTEX_WAKE, 1);
+#endif // _WIN32
+}
+
+// FUNCTION _Wake_by_address_all
+void _Wake_by_address_all(atomic<uint32_t>& _Word) noexcept {
+#ifdef _WIN32
+    ::WakeByAddressAll(_TPLMGR addressof(_Word));
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    (void) _Futex(_Word, FUTEX_WAKE, static_cast<uint32_t>(INT_MAX));
+#endif // _WIN32
+}
+
+#ifdef _WIN32
 // FUNCTION shared_lock constructor/destructor
 shared_lock::shared_lock() noexcept : _Myimpl(SRWLOCK_INIT) {}
 
@@ -18,6 +106,11 @@ void shared_lock::lock() noexcept {
     ::AcquireSRWLockExclusive(_TPLMGR addressof(_Myimpl));
 }
 
+// FUNCTION shared_lock::try_lock
+_NODISCARD_ATTR bool shared_lock::try_lock() noexcept {
+    return ::TryAcquireSRWLockExclusive(_TPLMGR addressof(_Myimpl)) != 0;
+}
+
 // FUNCTION shared_lock::unlock
 void shared_lock::unlock() noexcept {
     ::ReleaseSRWLockExclusive(_TPLMGR addressof(_Myimpl));
@@ -28,10 +121,117 @@ void shared_lock::lock_shared() noexcept {
     ::AcquireSRWLockShared(_TPLMGR addressof(_Myimpl));
 }
 
+// FUNCTION shared_lock::try_lock_shared
+_NODISCARD_ATTR bool shared_lock::try_lock_shared() noexcept {
+    return ::TryAcquireSRWLockShared(_TPLMGR addressof(_Myimpl)) != 0;
+}
+
 // FUNCTION shared_lock::unlock_shared
 void shared_lock::unlock_shared() noexcept {
     ::ReleaseSRWLockShared(_TPLMGR addressof(_Myimpl));
 }
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+// FUNCTION shared_lock constructor/destructor
+shared_lock::shared_lock() noexcept : _Myimpl(0) {}
+
+shared_lock::~shared_lock() noexcept {}
+
+// FUNCTION shared_lock::lock
+void shared_lock::lock() noexcept {
+    constexpr uint32_t _Waiting = _Has_waiters | _Writer_waiting;
+    uint32_t _State             = 0;
+    if (_Myimpl.compare_exchange_strong(_State, _Locked_exclusive, _STD memory_order_acquire)) {
+        return; // uncontended, no system call
+    }
+
+    for (;;) {
+        if ((_State & ~_Waiting) == 0) { // free, try to acquire it
+            // Note: The waiting bits are kept, since other threads may still be blocked.
+            //       They are cleared by unlock(), which wakes all of them.
+            if (_Myimpl.compare_exchange_weak(
+                _State, _State | _Locked_exclusive, _STD memory_order_acquire)) {
+                return;
+            }
+
+            continue; // _State reloaded by compare_exchange_weak()
+        }
+
+        if ((_State & _Waiting) != _Waiting && !_Myimpl.compare_exchange_weak(
+            _State, _State | _Waiting, _STD memory_order_relaxed)) {
+            continue; // the state has changed, try again
+        }
+
+        _Wait_on_address(_Myimpl, _State | _Waiting);
+        _State = _Myimpl.load(_STD memory_order_relaxed);
+    }
+}
+
+// FUNCTION shared_lock::try_lock
+_NODISCARD_ATTR bool shared_lock::try_lock() noexcept {
+    uint32_t _State = _Myimpl.load(_STD memory_order_relaxed);
+    while ((_State & ~static_cast<uint32_t>(_Has_waiters | _Writer_waiting)) == 0) { // free, try to acquire it
+        if (_Myimpl.compare_exchange_weak(_State, _State | _Locked_exclusive, _STD memory_order_acquire)) {
+            return true;
+        }
+    }
+
+    return false; // held by another thread
+}
+
+// FUNCTION shared_lock::unlock
+void shared_lock::unlock() noexcept {
+    if (_Myimpl.exchange(0, _STD memory_order_release) & _Has_waiters) { // wake all blocked threads
+        _Wake_by_address_all(_Myimpl);
+    }
+}
+
+// FUNCTION shared_lock::lock_shared
+void shared_lock::lock_shared() noexcept {
+    uint32_t _State = _Myimpl.load(_STD memory_order_relaxed);
+    for (;;) {
+        if ((_State & (_Locked_exclusive | _Writer_waiting)) == 0) { // no writer, try to join other readers
+            if (_Myimpl.compare_exchange_weak(
+                _State, _State + _Shared_unit, _STD memory_order_acquire)) {
+                return;
+            }
+
+            continue; // _State reloaded by compare_exchange_weak()
+        }
+
+        if ((_State & _Has_waiters) == 0 && !_Myimpl.compare_exchange_weak(
+            _State, _State | _Has_waiters, _STD memory_order_relaxed)) {
+            continue; // the state has changed, try again
+        }
+
+        _Wait_on_address(_Myimpl, _State | _Has_waiters);
+        _State = _Myimpl.load(_STD memory_order_relaxed);
+    }
+}
+
+// FUNCTION shared_lock::try_lock_shared
+_NODISCARD_ATTR bool shared_lock::try_lock_shared() noexcept {
+    uint32_t _State = _Myimpl.load(_STD memory_order_relaxed);
+    while ((_State & (_Locked_exclusive | _Writer_waiting)) == 0) { // no writer, try to join other readers
+        if (_Myimpl.compare_exchange_weak(_State, _State + _Shared_unit, _STD memory_order_acquire)) {
+            return true;
+        }
+    }
+
+    return false; // held or awaited by a writer
+}
+
+// FUNCTION shared_lock::unlock_shared
+void shared_lock::unlock_shared() noexcept {
+    uint32_t _State = _Myimpl.fetch_sub(_Shared_unit, _STD memory_order_release) - _Shared_unit;
+    if (_State != 0 && (_State & ~static_cast<uint32_t>(_Has_waiters | _Writer_waiting)) == 0) {
+        // Note: The last reader wakes all blocked threads. If the exchange fails, the lock has been
+        //       acquired again. The new owner will see the _Has_waiters bit and wake them once it unlocks.
+        if (_Myimpl.compare_exchange_strong(_State, 0, _STD memory_order_relaxed)) {
+            _Wake_by_address_all(_Myimpl);
+        }
+    }
+}
+#endif // _WIN32
 
 // FUNCTION lock_guard copy constructor/destructor
 lock_guard::lock_guard(shared_lock& _Lock) noexcept : _Mylock(_Lock) {
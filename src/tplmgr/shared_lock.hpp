@@ -9,9 +9,35 @@
 #include <tplmgr/core.hpp>
 #if _TPLMGR_PREPROCESSOR_GUARD
 #include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstdint>
+#ifdef _WIN32
 #include <synchapi.h>
+#endif // _WIN32
 
 _TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// FUNCTION _Wait_on_address
+extern void _Wait_on_address(atomic<uint32_t>& _Word, const uint32_t _Expected) noexcept;
+
+// FUNCTION _Wait_on_address_for
+extern bool _Wait_on_address_for(
+    atomic<uint32_t>& _Word, const uint32_t _Expected, const uint32_t _Milliseconds) noexcept;
+
+// FUNCTION _Tick_count
+extern uint64_t _Tick_count() noexcept;
+
+// FUNCTION _Precise_tick_count
+extern uint64_t _Precise_tick_count() noexcept;
+
+// FUNCTION _Wake_by_address_single
+extern void _Wake_by_address_single(atomic<uint32_t>& _Word) noexcept;
+
+// FUNCTION _Wake_by_address_all
+extern void _Wake_by_address_all(atomic<uint32_t>& _Word) noexcept;
+
 // CLASS shared_lock
 class _TPLMGR_API shared_lock { // non-copyable shared/exclusive lock object
 public:
@@ -24,17 +50,36 @@ public:
     // locks the code segment (exclusive mode)
     void lock() noexcept;
 
+    // tries to lock the code segment (exclusive mode) without blocking
+    _NODISCARD_ATTR bool try_lock() noexcept;
+
     // unlocks the code segment (exclusive mode)
     void unlock() noexcept;
 
     // locks the code segment (shared mode)
     void lock_shared() noexcept;
 
+    // tries to lock the code segment (shared mode) without blocking
+    _NODISCARD_ATTR bool try_lock_shared() noexcept;
+
     // unlocks the code segment (shared mode)
     void unlock_shared() noexcept;
 
 private:
+#ifdef _WIN32
     SRWLOCK _Myimpl;
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+    // Note: A blocked writer sets _Writer_waiting, so new readers wait as well and the writer
+    //       gets the lock once the current readers leave, instead of starving behind new ones.
+    enum : uint32_t {
+        _Locked_exclusive = 0x1, // held by a writer
+        _Has_waiters      = 0x2, // some thread is blocked on the lock
+        _Writer_waiting   = 0x4, // some writer is blocked on the lock, readers must not join
+        _Shared_unit      = 0x8 // added per reader
+    };
+
+    atomic<uint32_t> _Myimpl;
+#endif // _WIN32
 };
 
 // CLASS lock_guard
@@ -0,0 +1,303 @@
+// shared_priority_queue.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_SHARED_PRIORITY_QUEUE_HPP_
+#define _TPLMGR_SHARED_PRIORITY_QUEUE_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/shared_queue.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// CLASS TEMPLATE _Bucketed_queue
+template <class _Ty, size_t _Levels>
+class _Bucketed_queue { // non-throwing priority queue, one FIFO queue per priority level
+private:
+    static_assert(_Levels > 0 && _Levels <= 32, "The number of levels must be in range [1, 32].");
+
+    // Note: The bit N of _Myocc is set if the bucket N is not empty, so the highest
+    //       non-empty bucket is found with a single bit scan. Push and pop are O(1).
+    using _Bucket_t = _Unsynchronized_queue<_Ty>;
+
+public:
+    using value_type      = _Ty;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+    using pointer         = _Ty*;
+    using const_pointer   = const _Ty*;
+    using reference       = _Ty&;
+    using const_reference = const _Ty&;
+
+    static constexpr size_type levels = _Levels;
+
+    _Bucketed_queue() noexcept : _Mybuckets(), _Myocc(0), _Mysize(0) {}
+
+    ~_Bucketed_queue() noexcept {}
+
+    _Bucketed_queue(const _Bucketed_queue&) = delete;
+    _Bucketed_queue& operator=(const _Bucketed_queue&) = delete;
+
+    bool _Empty() const noexcept {
+        return _Mysize == 0;
+    }
+
+    size_type _Size() const noexcept {
+        return _Mysize;
+    }
+
+    size_type _Max_size() const noexcept {
+        return _Mybuckets[0]._Max_size();
+    }
+
+    bool _Full() const noexcept {
+        return _Mysize == _Max_size();
+    }
+
+    _Ty _Front() const noexcept {
+        return !_Empty() ? _Mybuckets[_Bit_scan_reverse(_Myocc)]._Front() : value_type{};
+    }
+
+    void _Clear() noexcept {
+        for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+            _Mybuckets[_Level]._Clear();
+        }
+
+        _Myocc  = 0;
+        _Mysize = 0;
+    }
+
+    void _Swap(_Bucketed_queue& _Other) noexcept {
+        for (size_type _Level = 0; _Level < _Levels; ++_Level) {
+            auto _Mine   = _Mybuckets[_Level]._Release();
+            auto _Theirs = _Other._Mybuckets[_Level]._Release();
+            _Mybuckets[_Level]._Assign(_Theirs._First, _Theirs._Last, _Theirs._Size);
+            _Other._Mybuckets[_Level]._Assign(_Mine._First, _Mine._Last, _Mine._Size);
+        }
+
+        _Myocc  = _TPLMGR exchange(_Other._Myocc, _Myocc);
+        _Mysize = _TPLMGR exchange(_Other._Mysize, _Mysize);
+    }
+
+    _NODISCARD_ATTR bool _Push(const _Ty& _Val, const size_type _Level) noexcept {
+        if (_Level >= _Levels || !_Mybuckets[_Level]._Push(_Val)) { // invalid level or allocation failed
+            return false;
+        }
+
+        _Myocc |= uint32_t{1} << _Level;
+        ++_Mysize;
+        return true;
+    }
+
+    _NODISCARD_ATTR bool _Push(_Ty&& _Val, const size_type _Level) noexcept {
+        if (_Level >= _Levels || !_Mybuckets[_Level]._Push(_STD move(_Val))) {
+            return false;
+        }
+
+        _Myocc |= uint32_t{1} << _Level;
+        ++_Mysize;
+        return true;
+    }
+
+    template <class _Source>
+    size_type _Push_many(const _Source& _Src, const size_type _Count, const size_type _Level) noexcept {
+        if (_Level >= _Levels) { // invalid level
+            return 0;
+        }
+
+        _Bucket_t& _Bucket = _Mybuckets[_Level];
+        size_type _Pushed  = 0;
+        while (_Pushed < _Count && _Bucket._Push(_Src[_Pushed])) {
+            ++_Pushed;
+        }
+
+        if (_Pushed > 0) {
+            _Myocc |= uint32_t{1} << _Level;
+            _Mysize += _Pushed;
+        }
+
+        return _Pushed;
+    }
+
+    _Ty _Pop() noexcept { // pops the oldest value from the highest non-empty level
+        if (_Empty()) {
+            return _Ty{};
+        }
+
+        const uint32_t _Level = _Bit_scan_reverse(_Myocc);
+        _Bucket_t& _Bucket    = _Mybuckets[_Level];
+        _Ty _Val              = _Bucket._Pop();
+        if (_Bucket._Empty()) { // the last value on this level
+            _Myocc &= ~(uint32_t{1} << _Level);
+        }
+
+        --_Mysize;
+        return _Val;
+    }
+
+    size_type _Pop_many(_Ty* const _Dest, const size_type _Count) noexcept {
+        size_type _Popped = 0;
+        while (_Popped < _Count && _Myocc != 0) { // drain levels from the highest one
+            const uint32_t _Level = _Bit_scan_reverse(_Myocc);
+            _Bucket_t& _Bucket    = _Mybuckets[_Level];
+            _Popped += _Bucket._Pop_many(_Dest + _Popped, _Count - _Popped);
+            if (_Bucket._Empty()) {
+                _Myocc &= ~(uint32_t{1} << _Level);
+            }
+        }
+
+        _Mysize -= _Popped;
+        return _Popped;
+    }
+
+private:
+    _Bucket_t _Mybuckets[_Levels];
+    uint32_t _Myocc; // occupancy bitmap
+    size_type _Mysize;
+};
+
+// CLASS TEMPLATE shared_priority_queue
+template <class _Ty, size_t _Levels>
+class shared_priority_queue { // non-throwing thread-safe priority queue (higher level first)
+private:
+    using _Container = _Bucketed_queue<_Ty, _Levels>;
+
+public:
+    using value_type      = typename _Container::value_type;
+    using size_type       = typename _Container::size_type;
+    using difference_type = typename _Container::difference_type;
+    using pointer         = typename _Container::pointer;
+    using const_pointer   = typename _Container::const_pointer;
+    using reference       = typename _Container::reference;
+    using const_reference = typename _Container::const_reference;
+
+    static constexpr size_type levels = _Levels;
+
+    shared_priority_queue() noexcept : _Mycont(), _Mylock(), _Myapprox(0) {}
+
+    shared_priority_queue(shared_priority_queue&& _Other) noexcept : _Mycont(), _Mylock(), _Myapprox(0) {
+        lock_guard _Guard(_Other._Mylock);
+        _Mycont._Swap(_Other._Mycont);
+        _Other._Publish_size();
+        _Publish_size();
+    }
+
+    ~shared_priority_queue() noexcept {}
+
+    shared_priority_queue& operator=(shared_priority_queue&& _Other) noexcept {
+        if (this != _TPLMGR addressof(_Other)) {
+            _Container _Temp;
+            {
+                lock_guard _Guard(_Other._Mylock);
+                _Temp._Swap(_Other._Mycont);
+                _Other._Publish_size();
+            }
+
+            lock_guard _Guard(_Mylock);
+            _Mycont._Swap(_Temp); // _Temp destroys the old values
+            _Publish_size();
+        }
+
+        return *this;
+    }
+
+    shared_priority_queue(const shared_priority_queue&) = delete;
+    shared_priority_queue& operator=(const shared_priority_queue&) = delete;
+
+    void clear() noexcept {
+        lock_guard _Guard(_Mylock);
+        _Mycont._Clear();
+        _Publish_size();
+    }
+
+    bool empty() const noexcept {
+        shared_lock_guard _Guard(_Mylock);
+        return _Mycont._Empty();
+    }
+
+    bool full() const noexcept {
+        shared_lock_guard _Guard(_Mylock);
+        return _Mycont._Full();
+    }
+
+    size_type size() const noexcept {
+        shared_lock_guard _Guard(_Mylock);
+        return _Mycont._Size();
+    }
+
+    // returns the number of values without locking (may be outdated)
+    size_type approximate_size() const noexcept {
+        return _Myapprox.load(_STD memory_order_relaxed);
+    }
+
+    size_type max_size() const noexcept {
+        shared_lock_guard _Guard(_Mylock);
+        return _Mycont._Max_size();
+    }
+
+    value_type front() const noexcept {
+        shared_lock_guard _Guard(_Mylock);
+        return _Mycont._Front();
+    }
+
+    _NODISCARD_ATTR bool push(const value_type& _Val, const size_type _Level) noexcept {
+        lock_guard _Guard(_Mylock);
+        const bool _Result = _Mycont._Push(_Val, _Level);
+        _Publish_size();
+        return _Result;
+    }
+
+    _NODISCARD_ATTR bool push(value_type&& _Val, const size_type _Level) noexcept {
+        lock_guard _Guard(_Mylock);
+        const bool _Result = _Mycont._Push(_STD move(_Val), _Level);
+        _Publish_size();
+        return _Result;
+    }
+
+    // pushes _Src[0], ..., _Src[_Count - 1] under one lock, returns the number of pushed values
+    template <class _Source>
+    size_type push_many(const _Source& _Src, const size_type _Count, const size_type _Level) noexcept {
+        lock_guard _Guard(_Mylock);
+        const size_type _Pushed = _Mycont._Push_many(_Src, _Count, _Level);
+        _Publish_size();
+        return _Pushed;
+    }
+
+    value_type pop() noexcept {
+        lock_guard _Guard(_Mylock);
+        value_type _Val = _Mycont._Pop();
+        _Publish_size();
+        return _Val;
+    }
+
+    // pops up to _Count values (highest level first) under one lock, returns the number of popped values
+    size_type pop_many(value_type* const _Dest, const size_type _Count) noexcept {
+        lock_guard _Guard(_Mylock);
+        const size_type _Popped = _Mycont._Pop_many(_Dest, _Count);
+        _Publish_size();
+        return _Popped;
+    }
+
+private:
+    void _Publish_size() noexcept { // the lock must be held
+        _Myapprox.store(_Mycont._Size(), _STD memory_order_relaxed);
+    }
+
+    _Container _Mycont;
+    mutable shared_lock _Mylock;
+    atomic<size_type> _Myapprox; // the size, readable without locking
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_SHARED_PRIORITY_QUEUE_HPP_
\ No newline at end of file
@@ -55,7 +55,7 @@ struct _Unsynchronized_queue_storage {
 template <class _Ty>
 class _Unsynchronized_queue { // non-throwing node-based queue
 private:
-    using _Alloc     = allocator<void>;
+    using _Alloc     = _Node_free_list<_Unsynchronized_queue_node<_Ty>>;
     using _Node_t    = _Unsynchronized_queue_node<_Ty>;
     using _Storage_t = _Unsynchronized_queue_storage<_Ty>;
 
@@ -105,7 +105,7 @@ public:
             for (_Node_t* _Node = _Storage._First; _Node != nullptr; _Node = _Next) {
                 _Next = _Node->_Next;
                 _Node->~_Unsynchronized_queue_node();
-                _Al.deallocate(_Node, sizeof(_Node_t));
+                _Al._Deallocate(_Node);
             }
 
             _Storage._First = nullptr;
@@ -144,9 +144,30 @@ public:
         _Storage._Size       = _Size;
     }
 
+    // returns the max number of retired nodes kept for reuse
+    size_type _Max_cached_nodes() const noexcept {
+        return _Mypair._Get_val2()._Capacity();
+    }
+
+    // changes the max number of retired nodes kept for reuse
+    void _Set_max_cached_nodes(const size_type _Count) noexcept {
+        _Mypair._Get_val2()._Set_capacity(_Count);
+    }
+
+    // tries to make room for _Count values, so that pushing them does not allocate
+    _NODISCARD_ATTR bool _Reserve(const size_type _Count) noexcept {
+        const size_type _Size = _Mypair._Val1._Size;
+        return _Count <= _Size ? true : _Mypair._Get_val2()._Reserve(_Count - _Size);
+    }
+
+    // frees all retired nodes
+    void _Shrink_to_fit() noexcept {
+        _Mypair._Get_val2()._Shrink_to_fit();
+    }
+
     _NODISCARD_ATTR bool _Push(const _Ty& _Val) noexcept {
         _Alloc& _Al      = _Mypair._Get_val2();
-        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        void* const _Raw = _Al._Allocate();
         if (!_Raw) { // allocation failed
             return false;
         }
@@ -167,7 +188,7 @@ public:
 
     _NODISCARD_ATTR bool _Push(_Ty&& _Val) noexcept {
         _Alloc& _Al      = _Mypair._Get_val2();
-        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        void* const _Raw = _Al._Allocate();
         if (!_Raw) { // allocation failed
             return false;
         }
@@ -189,7 +210,7 @@ public:
     template <class _Pr>
     _NODISCARD_ATTR bool _Push_with_priority(const _Ty& _Val, _Pr _Pred) noexcept {
         _Alloc& _Al      = _Mypair._Get_val2();
-        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        void* const _Raw = _Al._Allocate();
         if (!_Raw) { // allocation failed
             return false;
         }
@@ -264,7 +285,7 @@ public:
     template <class _Pr>
     _NODISCARD_ATTR bool _Push_with_priority(_Ty&& _Val, _Pr _Pred) noexcept {
         _Alloc& _Al      = _Mypair._Get_val2();
-        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        void* const _Raw = _Al._Allocate();
         if (!_Raw) { // allocation failed
             return false;
         }
@@ -347,7 +368,7 @@ public:
             _Node_t* _First = _Storage._First;
             const _Ty _Val  = static_cast<_Ty&&>(_First->_Value);
             _First->~_Unsynchronized_queue_node();
-            _Al.deallocate(_First, sizeof(_Node_t));
+            _Al._Deallocate(_First);
             _Storage._First = nullptr;
             _Storage._Last  = nullptr;
             _Storage._Size  = 0;
@@ -361,13 +382,22 @@ public:
             _Storage._First      = _First->_Next;
             const _Ty _Val       = static_cast<_Ty&&>(_First->_Value);
             _First->~_Unsynchronized_queue_node();
-            _Al.deallocate(_First, sizeof(_Node_t));
+            _Al._Deallocate(_First);
             --_Storage._Size;
             return _Val;
         }
         }
     }
 
+    size_type _Pop_many(_Ty* const _Dest, const size_type _Count) noexcept {
+        size_type _Popped = 0;
+        while (_Popped < _Count && !_Empty()) {
+            _Dest[_Popped++] = _Pop();
+        }
+
+        return _Popped;
+    }
+
 private:
     _Ebco_pair<_Storage_t, _Alloc> _Mypair;
 };
@@ -438,6 +468,30 @@ public:
         return _Mycont._Front();
     }
     
+    // returns the max number of retired nodes kept for reuse
+    size_type max_cached_nodes() const noexcept {
+        shared_lock_guard _Guard(_Mylock);
+        return _Mycont._Max_cached_nodes();
+    }
+
+    // changes the max number of retired nodes kept for reuse
+    void set_max_cached_nodes(const size_type _Count) noexcept {
+        lock_guard _Guard(_Mylock);
+        _Mycont._Set_max_cached_nodes(_Count);
+    }
+
+    // tries to make room for _Count values, so that pushing them does not allocate
+    _NODISCARD_ATTR bool reserve(const size_type _Count) noexcept {
+        lock_guard _Guard(_Mylock);
+        return _Mycont._Reserve(_Count);
+    }
+
+    // frees all retired nodes
+    void shrink_to_fit() noexcept {
+        lock_guard _Guard(_Mylock);
+        _Mycont._Shrink_to_fit();
+    }
+
     _NODISCARD_ATTR bool push(const value_type& _Val) noexcept {
         lock_guard _Guard(_Mylock);
         return _Mycont._Push(_Val);
@@ -465,6 +519,30 @@ public:
         return _Mycont._Pop();
     }
 
+    // pops up to _Count values under one lock, returns the number of popped values
+    size_type pop_many(value_type* const _Dest, const size_type _Count) noexcept {
+        lock_guard _Guard(_Mylock);
+        return _Mycont._Pop_many(_Dest, _Count);
+    }
+
+    // takes all values under one lock, then passes them to _Func (in FIFO order)
+    template <class _Fn>
+    size_type drain_into(_Fn _Func) noexcept {
+        _Container _Temp;
+        {
+            lock_guard _Guard(_Mylock);
+            _Released_storage _Storage = _Mycont._Release();
+            _Temp._Assign(_Storage._First, _Storage._Last, _Storage._Size);
+        }
+
+        const size_type _Count = _Temp._Size();
+        while (!_Temp._Empty()) {
+            _Func(_Temp._Pop());
+        }
+
+        return _Count;
+    }
+
 private:
     using _Released_storage = typename _Container::_Released_storage;
 
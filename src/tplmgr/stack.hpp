@@ -54,7 +54,7 @@ private:
     //       It is used as a thread's event callback container, so it needs to be iterable.
     //       There is no need to access a specific element. Its primary use is to
     //       iterate from bottom to top as a continuous array.
-    using _Alloc     = allocator<void>;
+    using _Alloc     = _Node_free_list<_Stack_node<_Ty>>;
     using _Node_t    = _Stack_node<_Ty>;
     using _Storage_t = _Stack_storage<_Ty>;
 
@@ -130,7 +130,7 @@ public:
             for (_Node_t* _Node = _Storage._Bottom; _Node != nullptr; _Node = _Next) {
                 _Next = _Node->_Next;
                 _Node->~_Stack_node();
-                _Al.deallocate(_Node, sizeof(_Node_t));
+                _Al._Deallocate(_Node);
             }
 
             _Storage._Bottom = nullptr;
@@ -139,9 +139,30 @@ public:
         }
     }
 
+    // returns the max number of retired nodes kept for reuse
+    size_type _Max_cached_nodes() const noexcept {
+        return _Mypair._Get_val2()._Capacity();
+    }
+
+    // changes the max number of retired nodes kept for reuse
+    void _Set_max_cached_nodes(const size_type _Count) noexcept {
+        _Mypair._Get_val2()._Set_capacity(_Count);
+    }
+
+    // tries to make room for _Count values, so that pushing them does not allocate
+    _NODISCARD_ATTR bool _Reserve(const size_type _Count) noexcept {
+        const size_type _Size = _Mypair._Val1._Size;
+        return _Count <= _Size ? true : _Mypair._Get_val2()._Reserve(_Count - _Size);
+    }
+
+    // frees all retired nodes
+    void _Shrink_to_fit() noexcept {
+        _Mypair._Get_val2()._Shrink_to_fit();
+    }
+
     _NODISCARD_ATTR bool _Push(const _Ty& _Val) noexcept {
         _Alloc& _Al      = _Mypair._Get_val2();
-        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        void* const _Raw = _Al._Allocate();
         if (!_Raw) { // allocation failed
             return false;
         }
@@ -161,7 +182,7 @@ public:
 
     _NODISCARD_ATTR bool _Push(_Ty&& _Val) noexcept {
         _Alloc& _Al      = _Mypair._Get_val2();
-        void* const _Raw = _Al.allocate(sizeof(_Node_t));
+        void* const _Raw = _Al._Allocate();
         if (!_Raw) { // allocation failed
             return false;
         }
@@ -189,7 +210,7 @@ public:
             _Alloc& _Al    = _Mypair._Get_val2();
             _Node_t* _Node = _Storage._Bottom; // same as _Storage._Top
             _Node->~_Stack_node();
-            _Al.deallocate(_Node, sizeof(_Node_t));
+            _Al._Deallocate(_Node);
             _Storage._Bottom = nullptr;
             _Storage._Top    = nullptr;
             _Storage._Size   = 0;
@@ -200,7 +221,7 @@ public:
             _Alloc& _Al    = _Mypair._Get_val2();
             _Node_t* _Node = _Storage._Top;
             _Node->~_Stack_node();
-            _Al.deallocate(_Node, sizeof(_Node_t));
+            _Al._Deallocate(_Node);
             _Storage._Bottom->_Next = nullptr;
             _Storage._Top           = _Storage._Bottom;
             _Storage._Size          = 1;
@@ -217,7 +238,7 @@ public:
             _Node_t* _Top = _Node->_Next; // _Node->_Next is same as _Storage._Top
             _Node->_Next  = nullptr;
             _Top->~_Stack_node();
-            _Al.deallocate(_Top, sizeof(_Node_t));
+            _Al._Deallocate(_Top);
             _Storage._Top = _Node;
             --_Storage._Size;
             break;
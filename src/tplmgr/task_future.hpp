@@ -0,0 +1,336 @@
+// task_future.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_TASK_FUTURE_HPP_
+#define _TPLMGR_TASK_FUTURE_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/thread_pool.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+using _STD decay_t;
+
+// CLASS TEMPLATE task_future
+template <class _Ty>
+class task_future;
+
+// STRUCT TEMPLATE _Future_value
+template <class _Ty>
+struct _Future_value { // storage for the task's result
+    _Ty& _Get() noexcept {
+        return *_STD launder(reinterpret_cast<_Ty*>(_Storage));
+    }
+
+    template <class _Fn>
+    void _Emplace(_Fn& _Func) {
+        ::new (static_cast<void*>(_Storage)) _Ty(_Func());
+    }
+
+    void _Destroy() noexcept {
+        _Get().~_Ty();
+    }
+
+    alignas(_Ty) unsigned char _Storage[sizeof(_Ty)];
+};
+
+template <>
+struct _Future_value<void> { // no storage, the task only signals completion
+    template <class _Fn>
+    void _Emplace(_Fn& _Func) {
+        _Func();
+    }
+
+    void _Destroy() noexcept {}
+};
+
+// CLASS TEMPLATE _Future_state
+template <class _Ty>
+class _Future_state { // shared state of a task and its future
+public:
+    enum : uint32_t {
+        _Ready            = 0x1, // the result is available
+        _Has_continuation = 0x2, // then() has been called
+        _Has_waiters      = 0x4 // some thread is blocked in wait()
+    };
+
+    // Note: The state is the head of a single allocation that also holds the task's callable.
+    //       It is owned by the task and by the future (or by the continuation after then()).
+    _Future_state(const size_t _Bytes, const size_t _Align) noexcept
+        : _Mystate(0), _Myrefs(2), _Mybytes(_Bytes), _Myalign(_Align), _Mypool(nullptr),
+          _Mycontinuation(), _Myhas_value(false) {}
+
+    _Future_state(const _Future_state&) = delete;
+    _Future_state& operator=(const _Future_state&) = delete;
+
+    bool _Is_ready() const noexcept {
+        return (_Mystate.load(_STD memory_order_acquire) & _Ready) != 0;
+    }
+
+    void _Wait() noexcept {
+        // Note: Short tasks usually finish while the caller is spinning,
+        //       so the syscall is made only if the result isn't available soon.
+        for (uint32_t _Spins = 0;;) {
+            uint32_t _State = _Mystate.load(_STD memory_order_acquire);
+            if (_State & _Ready) {
+                return;
+            }
+
+            if (_Spins < _Default_spin_count) {
+                ++_Spins;
+                _Yield_processor();
+                continue;
+            }
+
+            if (!(_State & _Has_waiters)) { // tell the task to wake this thread
+                if (!_Mystate.compare_exchange_weak(_State, _State | _Has_waiters, _STD memory_order_acquire)) {
+                    continue;
+                }
+
+                _State |= _Has_waiters;
+            }
+
+            _Wait_on_address(_Mystate, _State);
+        }
+    }
+
+    // stores the result of _Func and runs the continuation (if any)
+    template <class _Fn>
+    void _Complete(_Fn& _Func) {
+        _Myvalue._Emplace(_Func);
+        _Myhas_value              = true;
+        const uint32_t _Old_state = _Mystate.fetch_or(_Ready, _STD memory_order_acq_rel);
+        if (_Old_state & _Has_waiters) {
+            _Wake_by_address_all(_Mystate);
+        }
+
+        if (_Old_state & _Has_continuation) { // then() has been called before the task finished
+            _Run_continuation();
+        }
+    }
+
+    // attaches a continuation, runs it if the result is already available
+    void _Attach(thread_pool& _Pool, const _Thread_task& _Task) noexcept {
+        _Mypool                   = _TPLMGR addressof(_Pool);
+        _Mycontinuation           = _Task;
+        const uint32_t _Old_state = _Mystate.fetch_or(_Has_continuation, _STD memory_order_acq_rel);
+        if (_Old_state & _Ready) { // the task has already finished
+            _Run_continuation();
+        }
+    }
+
+    // moves the result out of the state (must be ready)
+    _Ty _Take() noexcept {
+        if constexpr (_STD is_void_v<_Ty>) {
+            return;
+        } else {
+            _Ty _Result = _STD move(_Myvalue._Get());
+            _Myvalue._Destroy();
+            _Myhas_value = false;
+            return _Result;
+        }
+    }
+
+    void _Release() noexcept {
+        if (_Myrefs.fetch_sub(1, _STD memory_order_acq_rel) == 1) { // the last owner
+            if (_Myhas_value) {
+                _Myvalue._Destroy();
+            }
+
+            const size_t _Bytes = _Mybytes;
+            const size_t _Align = _Myalign;
+            this->~_Future_state();
+            allocator_traits::deallocate(this, _Bytes, _Align);
+        }
+    }
+
+private:
+    void _Run_continuation() noexcept {
+        // Note: If the continuation can't be scheduled (e.g. the pool is closed),
+        //       it runs immediately, so that its future becomes ready anyway.
+        if (!_Mypool->_Schedule_continuation(_Mycontinuation)) {
+            _Mycontinuation._Invoke();
+        }
+    }
+
+    atomic<uint32_t> _Mystate;
+    atomic<uint32_t> _Myrefs;
+    size_t _Mybytes; // size of the whole allocation
+    size_t _Myalign; // alignment of the whole allocation
+    thread_pool* _Mypool; // the continuation's pool
+    _Thread_task _Mycontinuation;
+    bool _Myhas_value;
+    _Future_value<_Ty> _Myvalue;
+};
+
+// CLASS TEMPLATE _Future_task
+template <class _Ty, class _Fn>
+class _Future_task : public _Future_state<_Ty> { // the shared state merged with the task's callable
+public:
+    template <class... _Types>
+    explicit _Future_task(_Types&&... _Args) noexcept
+        : _Future_state<_Ty>(sizeof(_Future_task), alignof(_Future_task)), _Myfunc(_STD forward<_Types>(_Args)...) {}
+
+    // tries to allocate the task, returns null on failure
+    template <class... _Types>
+    static _Future_task* _Create(_Types&&... _Args) noexcept {
+        void* const _Raw = allocator_traits::allocate(sizeof(_Future_task), alignof(_Future_task));
+        return _Raw ? ::new (_Raw) _Future_task(_STD forward<_Types>(_Args)...) : nullptr;
+    }
+
+    // destroys a task that has never been scheduled
+    static void _Discard(_Future_task* const _Task) noexcept {
+        _Task->_Myfunc.~_Fn();
+        _Task->_Release();
+        _Task->_Release();
+    }
+
+    _Thread_task _Get_task(const task_priority _Priority) noexcept {
+        return _Thread_task{&_Run, this, _Priority};
+    }
+
+private:
+    static void __STDCALL_OR_CDECL _Run(void* const _Data) {
+        _Future_task* const _Task = static_cast<_Future_task*>(_Data);
+        _Task->_Complete(_Task->_Myfunc);
+        _Task->_Myfunc.~_Fn();
+        _Task->_Release();
+    }
+
+    _Fn _Myfunc;
+};
+
+// CLASS TEMPLATE _Continuation_call
+template <class _Ty, class _Fn>
+class _Continuation_call { // invokes the continuation with the previous task's result
+public:
+    template <class _Other>
+    _Continuation_call(_Other&& _Func, _Future_state<_Ty>* const _Prev) noexcept
+        : _Myfunc(_STD forward<_Other>(_Func)), _Myprev(_Prev) {}
+
+    ~_Continuation_call() noexcept {
+        _Myprev->_Release();
+    }
+
+    _Continuation_call(const _Continuation_call&) = delete;
+    _Continuation_call& operator=(const _Continuation_call&) = delete;
+
+    decltype(auto) operator()() {
+        if constexpr (_STD is_void_v<_Ty>) {
+            return _Myfunc();
+        } else {
+            return _Myfunc(_Myprev->_Take());
+        }
+    }
+
+private:
+    _Fn _Myfunc;
+    _Future_state<_Ty>* _Myprev;
+};
+
+// CLASS TEMPLATE task_future
+template <class _Ty>
+class task_future { // non-copyable handle to the result of a task
+public:
+    using value_type = _Ty;
+
+    task_future() noexcept : _Mystate(nullptr) {}
+
+    explicit task_future(_Future_state<_Ty>* const _State) noexcept : _Mystate(_State) {}
+
+    task_future(task_future&& _Other) noexcept : _Mystate(_Other._Mystate) {
+        _Other._Mystate = nullptr;
+    }
+
+    ~task_future() noexcept {
+        if (_Mystate) {
+            _Mystate->_Release();
+        }
+    }
+
+    task_future& operator=(task_future&& _Other) noexcept {
+        if (this != _TPLMGR addressof(_Other)) {
+            if (_Mystate) {
+                _Mystate->_Release();
+            }
+
+            _Mystate        = _Other._Mystate;
+            _Other._Mystate = nullptr;
+        }
+
+        return *this;
+    }
+
+    task_future(const task_future&) = delete;
+    task_future& operator=(const task_future&) = delete;
+
+    // checks if the future refers to a task (false if scheduling failed or after get()/then())
+    bool valid() const noexcept {
+        return _Mystate != nullptr;
+    }
+
+    // checks if the result is available (the future must be valid)
+    bool ready() const noexcept {
+        return _Mystate->_Is_ready();
+    }
+
+    // blocks until the result is available (the future must be valid)
+    void wait() const noexcept {
+        _Mystate->_Wait();
+    }
+
+    // waits for the result and takes it, the future becomes invalid (the future must be valid)
+    _Ty get() noexcept {
+        _Mystate->_Wait();
+        _Future_state<_Ty>* const _State = _TPLMGR exchange(_Mystate, nullptr);
+        if constexpr (_STD is_void_v<_Ty>) {
+            _State->_Release();
+        } else {
+            _Ty _Result = _State->_Take();
+            _State->_Release();
+            return _Result;
+        }
+    }
+
+    // schedules _Func on _Pool once the result is available, _Func receives the result,
+    // this future becomes invalid, the returned one is invalid if an allocation fails
+    template <class _Fn>
+    auto then(thread_pool& _Pool, _Fn&& _Func) noexcept {
+        using _Call_t   = _Continuation_call<_Ty, decay_t<_Fn>>;
+        using _Result_t = decay_t<decltype(_STD declval<_Call_t&>()())>;
+        using _Task_t   = _Future_task<_Result_t, _Call_t>;
+        if (!_Mystate) { // nothing to continue
+            return task_future<_Result_t>{};
+        }
+
+        // Note: The continuation takes over this future's reference to the state.
+        _Task_t* const _Task = _Task_t::_Create(_STD forward<_Fn>(_Func), _Mystate);
+        if (!_Task) { // allocation failed, keep this future valid
+            return task_future<_Result_t>{};
+        }
+
+        _Future_state<_Ty>* const _State = _TPLMGR exchange(_Mystate, nullptr);
+        _State->_Attach(_Pool, _Task->_Get_task(task_priority::normal));
+        return task_future<_Result_t>{_Task};
+    }
+
+private:
+    _Future_state<_Ty>* _Mystate;
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_TASK_FUTURE_HPP_
\ No newline at end of file
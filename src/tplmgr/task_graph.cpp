@@ -0,0 +1,385 @@
+// task_graph.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <tplmgr/tplmgr_pch.hpp>
+#include <tplmgr/task_graph.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+
+_TPLMGR_BEGIN
+// FUNCTION task_graph constructor/destructor
+task_graph::task_graph() noexcept
+    : _Mychunks(nullptr), _Mychunk_count(0), _Mysize(0), _Myedges(nullptr), _Myedge_count(0),
+    _Myedge_capacity(0), _Mysuccessors(nullptr), _Myroots(nullptr), _Myroot_count(0),
+    _Mycompiled_size(0), _Mycompiled(false), _Mypool(nullptr), _Myremaining(0), _Mystate(0) {}
+
+task_graph::~task_graph() noexcept {
+    wait(); // the nodes must not be destroyed while running
+    (void) clear();
+}
+
+// FUNCTION task_graph::size
+size_t task_graph::size() const noexcept {
+    return _Mysize;
+}
+
+// FUNCTION task_graph::empty
+bool task_graph::empty() const noexcept {
+    return _Mysize == 0;
+}
+
+// FUNCTION task_graph::is_running
+bool task_graph::is_running() const noexcept {
+    return (_Mystate.load(_STD memory_order_acquire) & _Running) != 0;
+}
+
+// FUNCTION task_graph::_Construct_node
+_Graph_node* task_graph::_Construct_node() noexcept {
+    if (is_running() || _Mysize == invalid_node) { // the nodes must not change while running
+        return nullptr;
+    }
+
+    if (_Mysize == _Mychunk_count * _Chunk_size) { // no free node, allocate a new chunk
+        _Alloc _Al;
+        void* const _Raw_chunks = _Al.allocate((_Mychunk_count + 1) * sizeof(_Graph_node*));
+        if (!_Raw_chunks) { // allocation failed
+            return nullptr;
+        }
+
+        void* const _Raw_nodes = allocator_traits::allocate(_Chunk_size * sizeof(_Graph_node), alignof(_Graph_node));
+        if (!_Raw_nodes) { // allocation failed
+            _Al.deallocate(_Raw_chunks, (_Mychunk_count + 1) * sizeof(_Graph_node*));
+            return nullptr;
+        }
+
+        _Graph_node** const _New_chunks = static_cast<_Graph_node**>(_Raw_chunks);
+        for (size_t _Idx = 0; _Idx < _Mychunk_count; ++_Idx) {
+            _New_chunks[_Idx] = _Mychunks[_Idx];
+        }
+
+        _New_chunks[_Mychunk_count] = static_cast<_Graph_node*>(_Raw_nodes);
+        if (_Mychunks) {
+            _Al.deallocate(_Mychunks, _Mychunk_count * sizeof(_Graph_node*));
+        }
+
+        _Mychunks = _New_chunks;
+        ++_Mychunk_count;
+    }
+
+    _Graph_node* const _Node = ::new (static_cast<void*>(_TPLMGR addressof(_At(_Mysize)))) _Graph_node;
+    _Node->_Task._Func       = nullptr;
+    _Node->_Task._Data       = nullptr;
+    _Node->_Task._Priority   = task_priority::normal;
+    _Node->_Destroy          = nullptr;
+    _Node->_Successors       = nullptr;
+    _Node->_Successor_count  = 0;
+    _Node->_Predecessors     = 0;
+    _Node->_Pending.store(0, _STD memory_order_relaxed);
+    _Node->_Next_ready       = nullptr;
+    _Node->_Graph            = this;
+    ++_Mysize;
+    _Mycompiled = false;
+    return _Node;
+}
+
+// FUNCTION task_graph::_Destroy_last_node
+void task_graph::_Destroy_last_node() noexcept {
+    _Graph_node& _Node = _At(--_Mysize);
+    if (_Node._Destroy) {
+        _Node._Destroy(_Node._Task);
+    }
+
+    _Node.~_Graph_node();
+    _Mycompiled = false;
+}
+
+// FUNCTION task_graph::add_node
+task_graph::node task_graph::add_node(const thread::task _Task, void* const _Data) noexcept {
+    _Graph_node* const _Node = _Construct_node();
+    if (!_Node) { // allocation failed
+        return invalid_node;
+    }
+
+    _Node->_Task._Func = _Task;
+    _Node->_Task._Data = _Data;
+    return static_cast<node>(_Mysize - 1);
+}
+
+// FUNCTION task_graph::add_edge
+_NODISCARD_ATTR bool task_graph::add_edge(const node _From, const node _To) noexcept {
+    if (is_running() || _From >= _Mysize || _To >= _Mysize || _From == _To) {
+        return false;
+    }
+
+    if (_Myedge_count == _Myedge_capacity) { // no free space, grow the array
+        if (_Myedge_capacity >= UINT32_MAX) { // the counters are 32-bit
+            return false;
+        }
+
+        _Alloc _Al;
+        const size_t _New_capacity = _Myedge_capacity == 0 ? 16 : _Myedge_capacity * 2;
+        void* const _Raw           = _Al.allocate(_New_capacity * sizeof(_Graph_edge));
+        if (!_Raw) { // allocation failed
+            return false;
+        }
+
+        _Graph_edge* const _New_edges = static_cast<_Graph_edge*>(_Raw);
+        for (size_t _Idx = 0; _Idx < _Myedge_count; ++_Idx) {
+            _New_edges[_Idx] = _Myedges[_Idx];
+        }
+
+        if (_Myedges) {
+            _Al.deallocate(_Myedges, _Myedge_capacity * sizeof(_Graph_edge));
+        }
+
+        _Myedges         = _New_edges;
+        _Myedge_capacity = _New_capacity;
+    }
+
+    _Myedges[_Myedge_count++] = _Graph_edge{_From, _To};
+    _Mycompiled               = false;
+    return true;
+}
+
+// FUNCTION task_graph::_Release_compiled
+void task_graph::_Release_compiled() noexcept {
+    _Alloc _Al;
+    if (_Mysuccessors) {
+        _Al.deallocate(_Mysuccessors, _Mycompiled_size * sizeof(_Graph_node*));
+        _Mysuccessors = nullptr;
+    }
+
+    if (_Myroots) {
+        _Al.deallocate(_Myroots, _Mycompiled_size * sizeof(void*));
+        _Myroots = nullptr;
+    }
+
+    _Myroot_count    = 0;
+    _Mycompiled_size = 0;
+    _Mycompiled      = false;
+}
+
+// FUNCTION task_graph::_Compile
+_NODISCARD_ATTR bool task_graph::_Compile() noexcept {
+    if (_Mycompiled) { // nothing has changed since the last run
+        return true;
+    }
+
+    // Note: Both arrays have the same capacity, _Myroots is also used to visit all nodes.
+    _Release_compiled();
+    _Alloc _Al;
+    const size_t _Capacity = _Mysize > _Myedge_count ? _Mysize : _Myedge_count;
+    _Mysuccessors          = static_cast<_Graph_node**>(_Al.allocate(_Capacity * sizeof(_Graph_node*)));
+    _Myroots               = static_cast<void**>(_Al.allocate(_Capacity * sizeof(void*)));
+    _Mycompiled_size       = _Capacity;
+    if (!_Mysuccessors || !_Myroots) { // allocation failed
+        _Release_compiled();
+        return false;
+    }
+
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        _Graph_node& _Node     = _At(_Idx);
+        _Node._Successor_count = 0;
+        _Node._Predecessors    = 0;
+    }
+
+    for (size_t _Idx = 0; _Idx < _Myedge_count; ++_Idx) {
+        ++_At(_Myedges[_Idx]._From)._Successor_count;
+        ++_At(_Myedges[_Idx]._To)._Predecessors;
+    }
+
+    // assign each node a contiguous part of the successors, then fill the parts
+    size_t _Offset = 0;
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        _Graph_node& _Node     = _At(_Idx);
+        _Node._Successors      = _Mysuccessors + _Offset;
+        _Offset               += _Node._Successor_count;
+        _Node._Successor_count = 0;
+    }
+
+    for (size_t _Idx = 0; _Idx < _Myedge_count; ++_Idx) {
+        _Graph_node& _From = _At(_Myedges[_Idx]._From);
+        const_cast<_Graph_node**>(_From._Successors)[_From._Successor_count++] =
+            _TPLMGR addressof(_At(_Myedges[_Idx]._To));
+    }
+
+    // Note: Nodes are visited in topological order (Kahn's algorithm). Nodes that become ready are
+    //       appended to _Myroots after the roots, if some node isn't visited, the graph has a cycle.
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        _Graph_node& _Node = _At(_Idx);
+        _Node._Pending.store(_Node._Predecessors, _STD memory_order_relaxed);
+        if (_Node._Predecessors == 0) {
+            _Myroots[_Myroot_count++] = _TPLMGR addressof(_Node);
+        }
+    }
+
+    size_t _Visited = _Myroot_count;
+    for (size_t _Idx = 0; _Idx < _Visited; ++_Idx) {
+        const _Graph_node* const _Node = static_cast<const _Graph_node*>(_Myroots[_Idx]);
+        for (uint32_t _Succ = 0; _Succ < _Node->_Successor_count; ++_Succ) {
+            _Graph_node* const _Next = _Node->_Successors[_Succ];
+            if (_Next->_Pending.fetch_sub(1, _STD memory_order_relaxed) == 1) { // all predecessors visited
+                _Myroots[_Visited++] = _Next;
+            }
+        }
+    }
+
+    if (_Visited != _Mysize) { // some nodes are never ready
+        _Release_compiled();
+        return false;
+    }
+
+    _Mycompiled = true;
+    return true;
+}
+
+// FUNCTION task_graph::_Finish_node
+void task_graph::_Finish_node() noexcept {
+    if (_Myremaining.fetch_sub(1, _STD memory_order_acq_rel) == 1) { // the last node, end the run
+        uint32_t _State = _Mystate.load(_STD memory_order_relaxed);
+        while (!_Mystate.compare_exchange_weak(
+            _State, (_State & ~(_Running | _Has_waiters)) + _Generation, _STD memory_order_release)) {}
+
+        if (_State & _Has_waiters) {
+            _Wake_by_address_all(_Mystate);
+        }
+    }
+}
+
+// FUNCTION task_graph::_Run_node
+void __STDCALL_OR_CDECL task_graph::_Run_node(void* const _Data) {
+    // Note: One successor that becomes ready is performed by the same thread (its data is likely
+    //       still in the cache), the other ones are scheduled, so that idle threads can take them.
+    _Graph_node* _Node        = static_cast<_Graph_node*>(_Data);
+    task_graph& _Graph        = *_Node->_Graph;
+    _Graph_node* _Unscheduled = nullptr; // ready nodes that couldn't be scheduled
+    while (_Node) {
+        _Node->_Task._Invoke();
+        _Graph_node* _Next = nullptr;
+        for (uint32_t _Idx = 0; _Idx < _Node->_Successor_count; ++_Idx) {
+            _Graph_node* const _Succ = _Node->_Successors[_Idx];
+            if (_Succ->_Pending.fetch_sub(1, _STD memory_order_acq_rel) != 1) { // still waiting
+                continue;
+            }
+
+            if (!_Next) {
+                _Next = _Succ;
+            } else if (!_Graph._Mypool->_Schedule_task(_Thread_task{&_Run_node, _Succ, task_priority::normal})) {
+                _Succ->_Next_ready = _Unscheduled; // perform it on this thread later
+                _Unscheduled       = _Succ;
+            }
+        }
+
+        if (!_Next && _Unscheduled) {
+            _Next        = _Unscheduled;
+            _Unscheduled = _Unscheduled->_Next_ready;
+        }
+
+        // Note: The graph may be destroyed once the last node has finished,
+        //       so it must not be accessed after that.
+        _Graph._Finish_node();
+        _Node = _Next;
+    }
+}
+
+// FUNCTION task_graph::run
+_NODISCARD_ATTR bool task_graph::run(thread_pool& _Pool) noexcept {
+    uint32_t _State = _Mystate.load(_STD memory_order_relaxed);
+    do {
+        if (_State & _Running) { // must finish first
+            return false;
+        }
+    } while (!_Mystate.compare_exchange_weak(_State, _State | _Running, _STD memory_order_acquire));
+
+    if (_Mysize == 0 || !_Compile()) { // nothing to do or some nodes would never be ready
+        _Mystate.fetch_and(~_Running, _STD memory_order_release);
+        return _Mysize == 0;
+    }
+
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) { // reset the counters of the previous run
+        _Graph_node& _Node = _At(_Idx);
+        _Node._Pending.store(_Node._Predecessors, _STD memory_order_relaxed);
+    }
+
+    _Mypool = _TPLMGR addressof(_Pool);
+    _Myremaining.store(static_cast<uint32_t>(_Mysize), _STD memory_order_relaxed);
+
+    // Note: Roots that couldn't be scheduled (e.g. the pool is closed) are performed by
+    //       the calling thread, so the run always finishes.
+    const size_t _Roots     = _Myroot_count;
+    const size_t _Scheduled = _Pool.schedule_tasks(&_Run_node, _Myroots, _Roots);
+    for (size_t _Idx = _Scheduled; _Idx < _Roots; ++_Idx) {
+        _Run_node(_Myroots[_Idx]);
+    }
+
+    return true;
+}
+
+// FUNCTION task_graph::wait
+void task_graph::wait() const noexcept {
+    uint32_t _State = _Mystate.load(_STD memory_order_acquire);
+    if (!(_State & _Running)) { // not running
+        return;
+    }
+
+    const uint32_t _Run = _State & ~(_Running | _Has_waiters); // the generation of the current run
+    for (uint32_t _Spins = 0;;) {
+        if (!(_State & _Running) || (_State & ~(_Running | _Has_waiters)) != _Run) { // finished
+            return;
+        }
+
+        if (_Spins < _Default_spin_count) {
+            ++_Spins;
+            _Yield_processor();
+            _State = _Mystate.load(_STD memory_order_acquire);
+            continue;
+        }
+
+        if (!(_State & _Has_waiters)) { // tell the last node to wake this thread
+            if (!_Mystate.compare_exchange_weak(_State, _State | _Has_waiters, _STD memory_order_acquire)) {
+                continue;
+            }
+
+            _State |= _Has_waiters;
+        }
+
+        _Wait_on_address(_Mystate, _State);
+        _State = _Mystate.load(_STD memory_order_acquire);
+    }
+}
+
+// FUNCTION task_graph::clear
+_NODISCARD_ATTR bool task_graph::clear() noexcept {
+    if (is_running()) { // the nodes must not change while running
+        return false;
+    }
+
+    while (_Mysize > 0) {
+        _Destroy_last_node();
+    }
+
+    _Alloc _Al;
+    for (size_t _Idx = 0; _Idx < _Mychunk_count; ++_Idx) {
+        allocator_traits::deallocate(_Mychunks[_Idx], _Chunk_size * sizeof(_Graph_node), alignof(_Graph_node));
+    }
+
+    if (_Mychunks) {
+        _Al.deallocate(_Mychunks, _Mychunk_count * sizeof(_Graph_node*));
+        _Mychunks      = nullptr;
+        _Mychunk_count = 0;
+    }
+
+    if (_Myedges) {
+        _Al.deallocate(_Myedges, _Myedge_capacity * sizeof(_Graph_edge));
+        _Myedges         = nullptr;
+        _Myedge_count    = 0;
+        _Myedge_capacity = 0;
+    }
+
+    _Release_compiled();
+    return true;
+}
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
\ No newline at end of file
@@ -0,0 +1,195 @@
+// task_graph.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_TASK_GRAPH_HPP_
+#define _TPLMGR_TASK_GRAPH_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/thread.hpp>
+#include <tplmgr/thread_pool.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+using _STD decay_t;
+
+// CLASS task_graph
+class task_graph;
+
+// STRUCT _Graph_node
+struct alignas(_Cache_line_size) _Graph_node { // node stored in the contiguous array
+    using _Destructor = void(*)(_Thread_task&) noexcept;
+
+    _Thread_task _Task;
+    _Destructor _Destroy; // destroys the node's callable (optional)
+    _Graph_node* const* _Successors; // nodes that depend on this one (valid once compiled)
+    uint32_t _Successor_count;
+    uint32_t _Predecessors; // number of nodes this one depends on
+    atomic<uint32_t> _Pending; // predecessors that haven't finished in the current run
+    _Graph_node* _Next_ready; // links ready nodes that couldn't be scheduled
+    task_graph* _Graph;
+};
+
+// STRUCT _Graph_edge
+struct _Graph_edge {
+    uint32_t _From;
+    uint32_t _To;
+};
+
+// CLASS task_graph
+class _TPLMGR_API task_graph { // nodes with dependencies, can be run many times
+public:
+    using node = uint32_t;
+
+    static constexpr node invalid_node = UINT32_MAX;
+
+    task_graph() noexcept;
+    ~task_graph() noexcept;
+
+    task_graph(const task_graph&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    // returns the number of nodes
+    size_t size() const noexcept;
+
+    // checks if the graph has no nodes
+    bool empty() const noexcept;
+
+    // checks if the graph is being run
+    bool is_running() const noexcept;
+
+    // tries to add a new node, returns invalid_node on failure (fails while running)
+    node add_node(const thread::task _Task, void* const _Data) noexcept;
+
+    // tries to add a new node that invokes _Func, returns invalid_node on failure (fails while running)
+    template <class _Fn>
+    node add_node(_Fn&& _Func) noexcept {
+        using _Func_t = decay_t<_Fn>;
+
+        // Note: Nodes never move, so small callables are stored in the node itself,
+        //       other ones are allocated once, not per run.
+        _Graph_node* const _Node = _Construct_node();
+        if (!_Node) { // allocation failed
+            return invalid_node;
+        }
+
+        if constexpr (sizeof(_Func_t) <= _Inline_task_size && alignof(_Func_t) <= alignof(void*)) {
+            ::new (static_cast<void*>(_Node->_Task._Storage)) _Func_t(_STD forward<_Fn>(_Func));
+            _Node->_Task._Func   = &_Invoke_inline<_Func_t>;
+            _Node->_Task._Inline = true;
+            _Node->_Destroy      = &_Destroy_inline<_Func_t>;
+        } else {
+            void* const _Raw = allocator_traits::allocate(sizeof(_Func_t), alignof(_Func_t));
+            if (!_Raw) { // allocation failed, discard the node
+                _Destroy_last_node();
+                return invalid_node;
+            }
+
+            _Node->_Task._Data = ::new (_Raw) _Func_t(_STD forward<_Fn>(_Func));
+            _Node->_Task._Func = &_Invoke_allocated<_Func_t>;
+            _Node->_Destroy    = &_Destroy_allocated<_Func_t>;
+        }
+
+        return static_cast<node>(_Mysize - 1);
+    }
+
+    // tries to make _To depend on _From (_To runs once _From has finished), fails while running
+    _NODISCARD_ATTR bool add_edge(const node _From, const node _To) noexcept;
+
+    // tries to run the graph on _Pool, fails if it's already running or contains a cycle
+    _NODISCARD_ATTR bool run(thread_pool& _Pool) noexcept;
+
+    // blocks until the current run has finished (must not be called by the graph's nodes)
+    void wait() const noexcept;
+
+    // tries to remove all nodes and edges, fails while running
+    _NODISCARD_ATTR bool clear() noexcept;
+
+private:
+    using _Alloc = allocator<void>;
+
+    enum : uint32_t {
+        _Running     = 0x1, // some run hasn't finished yet
+        _Has_waiters = 0x2, // some thread is blocked in wait()
+        _Generation  = 0x4 // added after each run, so that waiters don't miss a short run
+    };
+
+    static constexpr size_t _Chunk_size = 64; // nodes per chunk
+
+    template <class _Fn>
+    static void __STDCALL_OR_CDECL _Invoke_inline(void* const _Data) {
+        (*_STD launder(static_cast<_Fn*>(_Data)))();
+    }
+
+    template <class _Fn>
+    static void _Destroy_inline(_Thread_task& _Task) noexcept {
+        _STD launder(reinterpret_cast<_Fn*>(_Task._Storage))->~_Fn();
+    }
+
+    template <class _Fn>
+    static void __STDCALL_OR_CDECL _Invoke_allocated(void* const _Data) {
+        (*static_cast<_Fn*>(_Data))();
+    }
+
+    template <class _Fn>
+    static void _Destroy_allocated(_Thread_task& _Task) noexcept {
+        static_cast<_Fn*>(_Task._Data)->~_Fn();
+        allocator_traits::deallocate(_Task._Data, sizeof(_Fn), alignof(_Fn));
+    }
+
+    // performs the node and the successors that become ready on the current thread
+    static void __STDCALL_OR_CDECL _Run_node(void* const _Data);
+
+    // returns the node at the specified index
+    _Graph_node& _At(const size_t _Idx) const noexcept {
+        return _Mychunks[_Idx / _Chunk_size][_Idx % _Chunk_size];
+    }
+
+    // tries to construct a new node at the end of the array
+    _Graph_node* _Construct_node() noexcept;
+
+    // destroys the last node
+    void _Destroy_last_node() noexcept;
+
+    // tries to build the successor lists and the list of roots, fails if the graph has a cycle
+    _NODISCARD_ATTR bool _Compile() noexcept;
+
+    // releases the compiled successor lists and roots
+    void _Release_compiled() noexcept;
+
+    // counts the node as finished, ends the run if it's the last one
+    void _Finish_node() noexcept;
+
+    // Note: Nodes are stored in chunks that are never reallocated, so their addresses stay valid
+    //       while the graph is being run. Edges are compiled into contiguous successor lists
+    //       on the first run after a change, later runs only reset the counters.
+    _Graph_node** _Mychunks;
+    size_t _Mychunk_count;
+    size_t _Mysize;
+    _Graph_edge* _Myedges;
+    size_t _Myedge_count;
+    size_t _Myedge_capacity;
+    _Graph_node** _Mysuccessors; // successors of all nodes (grouped by node)
+    void** _Myroots; // nodes without predecessors (the first _Myroot_count)
+    size_t _Myroot_count;
+    size_t _Mycompiled_size; // capacity of _Mysuccessors and _Myroots
+    bool _Mycompiled;
+    thread_pool* _Mypool; // the pool of the current run
+    alignas(_Cache_line_size) atomic<uint32_t> _Myremaining; // nodes that haven't finished yet
+    mutable atomic<uint32_t> _Mystate;
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_TASK_GRAPH_HPP_
\ No newline at end of file
@@ -8,6 +8,7 @@
 #if _TPLMGR_PREPROCESSOR_GUARD
 
 _TPLMGR_BEGIN
+#ifdef _WIN32
 // FUNCTION _Hardware_concurrency
 size_t _Hardware_concurrency() noexcept {
     SYSTEM_INFO _Info;
@@ -15,48 +16,1068 @@ size_t _Hardware_concurrency() noexcept {
     return static_cast<size_t>(_Info.dwNumberOfProcessors);
 }
 
+// FUNCTION _Create_thread
+_NODISCARD_ATTR void* _Create_thread(
+    unsigned long(__stdcall* const _Routine)(void*), void* const _Data, unsigned int* const _Id) noexcept {
+    return ::CreateThread(nullptr, 0, _Routine, _Data, 0, reinterpret_cast<unsigned long*>(_Id));
+}
+
+// FUNCTION _Current_thread_id
+static unsigned int _Current_thread_id() noexcept {
+    return static_cast<unsigned int>(::GetCurrentThreadId());
+}
+
 // FUNCTION _Wait_for_thread
 void _Wait_for_thread(void* const _Handle) noexcept {
     ::WaitForSingleObject(_Handle, 0xFFFF'FFFF); // infinite timeout
 }
 
-// FUNCTION _Terminate_current_thread
-void _Terminate_current_thread() noexcept {
-    ::ExitThread(0);
+// FUNCTION _Close_thread
+void _Close_thread(void* const _Handle) noexcept {
+    ::CloseHandle(_Handle);
+}
+
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+// STRUCT _Posix_thread
+struct _Posix_thread { // native handle of a POSIX thread
+    pthread_t _Handle;
+    unsigned long(__stdcall* _Routine)(void*);
+    void* _Data;
+    atomic<uint32_t> _Refs; // the owner and the thread itself
+    unsigned int _Id; // generated ID, see _Create_thread()
+    bool _Joined;
+};
+
+// VARIABLE _Current_posix_id
+static thread_local unsigned int _Current_posix_id = 0; // 0 if the thread wasn't created by _Create_thread()
+
+// FUNCTION _Current_thread_id
+static unsigned int _Current_thread_id() noexcept {
+    return _Current_posix_id;
+}
+
+// FUNCTION _Release_posix_thread
+static void _Release_posix_thread(_Posix_thread* const _Thread) noexcept {
+    if (_Thread->_Refs.fetch_sub(1, _STD memory_order_acq_rel) == 1) { // the last reference
+        allocator<void> _Al;
+        _Thread->~_Posix_thread();
+        _Al.deallocate(_Thread, sizeof(_Posix_thread));
+    }
+}
+
+// FUNCTION _Posix_thread_start
+static void* _Posix_thread_start(void* const _Data) noexcept {
+    _Posix_thread* const _Thread = static_cast<_Posix_thread*>(_Data);
+    _Current_posix_id            = _Thread->_Id; // set before the routine runs, unlike the owner's copy
+    (void) (*_Thread->_Routine)(_Thread->_Data);
+    _Release_posix_thread(_Thread);
+    return nullptr;
 }
 
-// FUNCTION _Suspend_current_thread
-void _Suspend_current_thread() noexcept {
-    ::SuspendThread(::GetCurrentThread());
+// FUNCTION _Hardware_concurrency
+size_t _Hardware_concurrency() noexcept {
+    // Note: The affinity mask may be restricted (e.g. by cgroups or taskset), in which case
+    //       the number of online processors would overestimate the usable concurrency.
+    cpu_set_t _Set;
+    CPU_ZERO(_TPLMGR addressof(_Set));
+    if (::sched_getaffinity(0, sizeof(cpu_set_t), _TPLMGR addressof(_Set)) == 0) {
+        const int _Count = CPU_COUNT(_TPLMGR addressof(_Set));
+        if (_Count > 0) {
+            return static_cast<size_t>(_Count);
+        }
+    }
+
+    const long _Online = ::sysconf(_SC_NPROCESSORS_ONLN);
+    return _Online > 0 ? static_cast<size_t>(_Online) : 1;
 }
 
-// FUNCTION _Suspend_thread
-_NODISCARD_ATTR bool _Suspend_thread(void* const _Handle) noexcept {
-    return ::SuspendThread(_Handle) != static_cast<unsigned long>(-1);
+// FUNCTION _Create_thread
+_NODISCARD_ATTR void* _Create_thread(
+    unsigned long(__stdcall* const _Routine)(void*), void* const _Data, unsigned int* const _Id) noexcept {
+    static atomic<unsigned int> _Next_id(1); // POSIX thread IDs are opaque, generate own IDs
+    allocator<void> _Al;
+    void* const _Raw = _Al.allocate(sizeof(_Posix_thread));
+    if (!_Raw) { // allocation failed
+        return nullptr;
+    }
+
+    _Posix_thread* const _Thread = ::new (_Raw) _Posix_thread;
+    _Thread->_Routine            = _Routine;
+    _Thread->_Data               = _Data;
+    _Thread->_Refs.store(2, _STD memory_order_relaxed);
+    _Thread->_Id     = _Next_id.fetch_add(1, _STD memory_order_relaxed);
+    _Thread->_Joined = false;
+    if (::pthread_create(_TPLMGR addressof(_Thread->_Handle), nullptr, _Posix_thread_start, _Thread) != 0) {
+        _Thread->~_Posix_thread();
+        _Al.deallocate(_Raw, sizeof(_Posix_thread));
+        return nullptr;
+    }
+
+    *_Id = _Thread->_Id;
+    return _Thread;
 }
 
-// FUNCTION _Resume_thread
-_NODISCARD_ATTR bool _Resume_thread(void* const _Handle) noexcept {
-    return ::ResumeThread(_Handle) != static_cast<unsigned long>(-1);
+// FUNCTION _Wait_for_thread
+void _Wait_for_thread(void* const _Handle) noexcept {
+    _Posix_thread* const _Thread = static_cast<_Posix_thread*>(_Handle);
+    if (!_Thread->_Joined) {
+        _Thread->_Joined = ::pthread_join(_Thread->_Handle, nullptr) == 0;
+    }
+}
+
+// FUNCTION _Close_thread
+void _Close_thread(void* const _Handle) noexcept {
+    _Posix_thread* const _Thread = static_cast<_Posix_thread*>(_Handle);
+    if (!_Thread) {
+        return;
+    }
+
+    if (!_Thread->_Joined) { // nobody will join the thread, release its resources once it exits
+        (void) ::pthread_detach(_Thread->_Handle);
+    }
+
+    _Release_posix_thread(_Thread);
+}
+
+#endif // _WIN32
+
+// VARIABLE _Current_cache
+static thread_local _Thread_cache* _Current_cache = nullptr;
+
+// FUNCTION _Current_thread_cache
+_NODISCARD_ATTR _Thread_cache* _Current_thread_cache() noexcept {
+    return _Current_cache;
+}
+
+// FUNCTION _Thread_counters constructor
+_Thread_counters::_Thread_counters() noexcept
+    : _Executed(0), _Submitted(0), _Steals(0), _Parks(0), _Unparks(0), _High_water(0), _Sequence(0),
+    _Idle(false), _Since(0), _Busy_time(0), _Idle_time(0) {}
+
+// FUNCTION _Thread_counters::_Switch
+void _Thread_counters::_Switch(const bool _Idle_period, const uint64_t _Now) noexcept {
+    _Begin_period(_Idle_period, _Now, _Now);
+}
+
+// FUNCTION _Thread_counters::_Stop
+void _Thread_counters::_Stop(const uint64_t _Now) noexcept {
+    _Begin_period(false, _Now, 0); // nothing is counted until the next _Switch()
+}
+
+// FUNCTION _Thread_counters::_Begin_period
+void _Thread_counters::_Begin_period(const bool _Idle_period, const uint64_t _Now, const uint64_t _Start) noexcept {
+    // Note: Only the thread writes, so the sequence is a seqlock without a lock. A reader retries
+    //       if the sequence is odd or has changed while it was reading the times.
+    const uint32_t _Seq = _Sequence.load(_STD memory_order_relaxed);
+    _Sequence.store(_Seq + 1, _STD memory_order_relaxed);
+    _STD atomic_thread_fence(_STD memory_order_release);
+    const uint64_t _Previous = _Since.load(_STD memory_order_relaxed);
+    if (_Previous != 0 && _Now > _Previous) { // close the current period
+        _Add(_Idle.load(_STD memory_order_relaxed) ? _Idle_time : _Busy_time, _Now - _Previous);
+    }
+
+    _Idle.store(_Idle_period, _STD memory_order_relaxed);
+    _Since.store(_Start, _STD memory_order_relaxed);
+    _Sequence.store(_Seq + 2, _STD memory_order_release);
+}
+
+// FUNCTION _Thread_counters::_Read
+thread_counters _Thread_counters::_Read(const uint64_t _Now) const noexcept {
+    thread_counters _Result = {_Executed.load(_STD memory_order_relaxed),
+        _Submitted.load(_STD memory_order_relaxed), _Steals.load(_STD memory_order_relaxed),
+        _Parks.load(_STD memory_order_relaxed), _Unparks.load(_STD memory_order_relaxed), 0, 0,
+        _High_water.load(_STD memory_order_relaxed)};
+    for (;;) {
+        const uint32_t _Seq = _Sequence.load(_STD memory_order_acquire);
+        if (_Seq & 1) { // being updated, the thread finishes soon
+            _Yield_processor();
+            continue;
+        }
+
+        const uint64_t _Busy_total = _Busy_time.load(_STD memory_order_relaxed);
+        const uint64_t _Idle_total = _Idle_time.load(_STD memory_order_relaxed);
+        const uint64_t _Start      = _Since.load(_STD memory_order_relaxed);
+        const bool _Is_idle        = _Idle.load(_STD memory_order_relaxed);
+        _STD atomic_thread_fence(_STD memory_order_acquire);
+        if (_Sequence.load(_STD memory_order_relaxed) != _Seq) { // changed meanwhile, read again
+            continue;
+        }
+
+        const uint64_t _Current  = _Start != 0 && _Now > _Start ? _Now - _Start : 0;
+        _Result.busy_nanoseconds = _Busy_total + (_Is_idle ? 0 : _Current);
+        _Result.idle_nanoseconds = _Idle_total + (_Is_idle ? _Current : 0);
+        return _Result;
+    }
 }
 
 // FUNCTION _Thread_cache constructors
 _Thread_cache::_Thread_cache(_Thread_cache&& _Other) noexcept
-    : _State(_Other._State.exchange(thread_state::terminated)), _Queue(_STD move(_Other._Queue)) {}
+    : _State(_Other._State.exchange(thread_state::terminated)), _Epoch(0), _Parked(0),
+    _Spin_count(_Other._Spin_count.load(_STD memory_order_relaxed)), _Cancel_epoch(0), _Buffered(0),
+    _Idle_since(0), _Group(_Other._Group.exchange(nullptr, _STD memory_order_relaxed)),
+    _Owner(nullptr), _Slot(0),
+    _Seed(_Other._Seed), _Binding(_Other._Binding), _Node(_Other._Node), _Affinity(_Other._Affinity),
+    _Queue(_STD move(_Other._Queue)), _Deque(_STD move(_Other._Deque)), _Counters() {}
 
 _Thread_cache::_Thread_cache(const thread_state _State) noexcept
-    : _State(_State), _Queue() {}
+    : _State(_State), _Epoch(0), _Parked(0), _Spin_count(_Default_spin_count), _Cancel_epoch(0),
+    _Buffered(0), _Idle_since(0), _Group(nullptr), _Owner(nullptr), _Slot(0),
+    _Seed(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this) >> 6) | 1), _Binding(0), _Node(0),
+    _Affinity(thread_affinity::none), _Queue(), _Deque(), _Counters() {}
 
 // FUNCTION _Thread_cache::operator=
 _Thread_cache& _Thread_cache::operator=(_Thread_cache&& _Other) noexcept {
     if (this != _TPLMGR addressof(_Other)) {
         _State.store(_Other._State.exchange(thread_state::terminated), _STD memory_order_relaxed);
-        _Queue = _STD move(_Other._Queue);
+        _Spin_count.store(_Other._Spin_count.load(_STD memory_order_relaxed), _STD memory_order_relaxed);
+        _Group.store(_Other._Group.exchange(nullptr, _STD memory_order_relaxed), _STD memory_order_relaxed);
+        _Binding  = _Other._Binding;
+        _Node     = _Other._Node;
+        _Affinity = _Other._Affinity;
+        _Queue    = _STD move(_Other._Queue);
+        _Deque    = _STD move(_Other._Deque);
     }
 
     return *this;
 }
 
+// FUNCTION _Thread_cache::_Transition
+bool _Thread_cache::_Transition(thread_state _Old_state, const thread_state _New_state) noexcept {
+    if (!_State.compare_exchange_strong(_Old_state, _New_state)) { // the state has changed meanwhile
+        return false;
+    }
+
+    _Notify();
+    return true;
+}
+
+// FUNCTION _Thread_cache::_Force_transition
+void _Thread_cache::_Force_transition(const thread_state _New_state) noexcept {
+    _State.store(_New_state);
+    _Notify();
+}
+
+// FUNCTION _Thread_cache::_Notify
+void _Thread_cache::_Notify() noexcept {
+    // Note: The increment must precede the check of _Parked, see _Wait_while() for details.
+    _Epoch.fetch_add(1);
+    if (_Parked.load() != 0) { // the thread is blocked (or about to block), wake it
+        _Wake_by_address_single(_Epoch);
+    }
+}
+
+// FUNCTION _Thread_cache::_Wait_while
+void _Thread_cache::_Wait_while(const thread_state _Old_state) noexcept {
+    // Note: The thread spins for a while, because most state changes follow shortly after
+    //       the thread started waiting. If nothing has changed, it announces that it will block
+    //       (_Parked) and then reads _Epoch. A notifier changes the state, increments _Epoch
+    //       and then checks _Parked. All these operations are sequentially consistent, so either
+    //       the thread observes the new state (or _Epoch), or the notifier observes _Parked
+    //       and wakes the thread. In both cases, no wakeup can be lost.
+    const uint32_t _Spins = _Spin_count.load(_STD memory_order_relaxed);
+    for (uint32_t _Spin = 0; _Spin < _Spins; ++_Spin) {
+        if (_State.load(_STD memory_order_acquire) != _Old_state) {
+            return;
+        }
+
+        _Yield_processor();
+    }
+
+    for (;;) {
+        _Parked.store(1);
+        const uint32_t _Key = _Epoch.load();
+        if (_State.load() != _Old_state) { // the state has changed, don't block
+            break;
+        }
+
+        _Thread_counters::_Add(_Counters._Parks, 1);
+        _Wait_on_address(_Epoch, _Key); // returns immediately if _Epoch != _Key
+        _Thread_counters::_Add(_Counters._Unparks, 1);
+    }
+
+    _Parked.store(0, _STD memory_order_relaxed);
+}
+
+// FUNCTION _Thread_cache::_Approximate_load
+size_t _Thread_cache::_Approximate_load() const noexcept {
+    return _Queue.approximate_size() + _Buffered.load(_STD memory_order_relaxed) + _Deque._Size();
+}
+
+// FUNCTION _Thread_cache::_Bind
+void _Thread_cache::_Bind() noexcept {
+    const _Cpu_topology& _Topology = _Cpu_topology::_Get();
+    bool _Bound                    = false;
+    if (_Affinity == thread_affinity::cpu) {
+        const uint16_t _Cpu = static_cast<uint16_t>(_Binding);
+        _Bound              = _Bind_current_thread(_TPLMGR addressof(_Cpu), 1);
+    } else if (_Affinity == thread_affinity::numa_node) {
+        _Bound = _Bind_current_thread(_Topology._Node_cpus(_Binding), _Topology._Node_size(_Binding));
+    }
+
+    // Note: Memory is placed on the node of the thread that touches it first, so the thread
+    //       allocates its deque's buffer itself, once it runs on its node.
+    if (_Bound) {
+        (void) _Deque._Reserve(1);
+    }
+}
+
+// FUNCTION _Injection_queue constructor/destructor
+_Injection_queue::_Injection_queue() noexcept
+    : _Myfirst(nullptr), _Mylast(nullptr), _Myspare(nullptr), _Mysize(0), _Mylock() {}
+
+_Injection_queue::~_Injection_queue() noexcept {
+    _Clear();
+    if (_Myspare) {
+        _Alloc _Al;
+        _Al.deallocate(_Myspare, sizeof(_Injection_chunk));
+    }
+}
+
+// FUNCTION _Injection_queue::_Empty
+bool _Injection_queue::_Empty() const noexcept {
+    return _Mysize.load(_STD memory_order_relaxed) == 0;
+}
+
+// FUNCTION _Injection_queue::_Size
+size_t _Injection_queue::_Size() const noexcept {
+    return _Mysize.load(_STD memory_order_relaxed);
+}
+
+// FUNCTION _Injection_queue::_Clear
+size_t _Injection_queue::_Clear() noexcept {
+    lock_guard _Guard(_Mylock);
+    _Alloc _Al;
+    _Injection_chunk* _Next;
+    for (_Injection_chunk* _Chunk = _Myfirst; _Chunk != nullptr; _Chunk = _Next) {
+        _Next = _Chunk->_Next;
+        _Al.deallocate(_Chunk, sizeof(_Injection_chunk));
+    }
+
+    _Myfirst = nullptr;
+    _Mylast  = nullptr;
+    return _Mysize.exchange(0, _STD memory_order_relaxed);
+}
+
+// FUNCTION _Injection_queue::_Append_chunk
+_NODISCARD_ATTR bool _Injection_queue::_Append_chunk() noexcept {
+    _Injection_chunk* _Chunk = _TPLMGR exchange(_Myspare, nullptr);
+    if (!_Chunk) {
+        _Alloc _Al;
+        _Chunk = static_cast<_Injection_chunk*>(_Al.allocate(sizeof(_Injection_chunk)));
+        if (!_Chunk) { // allocation failed
+            return false;
+        }
+    }
+
+    _Chunk->_Next  = nullptr;
+    _Chunk->_Begin = 0;
+    _Chunk->_End   = 0;
+    if (_Mylast) {
+        _Mylast->_Next = _Chunk;
+    } else {
+        _Myfirst = _Chunk;
+    }
+
+    _Mylast = _Chunk;
+    return true;
+}
+
+// FUNCTION _Injection_queue::_Push
+_NODISCARD_ATTR bool _Injection_queue::_Push(const _Thread_task& _Task) noexcept {
+    lock_guard _Guard(_Mylock);
+    if (!_Mylast || _Mylast->_End == _Injection_chunk::_Capacity) { // no space, append a new chunk
+        if (!_Append_chunk()) {
+            return false;
+        }
+    }
+
+    _Mylast->_Tasks[_Mylast->_End++] = _Task;
+    _Mysize.fetch_add(1, _STD memory_order_relaxed); // published by unlock()
+    return true;
+}
+
+// FUNCTION _Injection_queue::_Push_many
+size_t _Injection_queue::_Push_many(const _Task_batch& _Batch) noexcept {
+    lock_guard _Guard(_Mylock);
+    size_t _Pushed = 0;
+    while (_Pushed < _Batch._Count) {
+        if (!_Mylast || _Mylast->_End == _Injection_chunk::_Capacity) { // no space, append a new chunk
+            if (!_Append_chunk()) {
+                break;
+            }
+        }
+
+        const size_t _Count = (_STD min)(
+            _Batch._Count - _Pushed, _Injection_chunk::_Capacity - _Mylast->_End);
+        for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+            _Mylast->_Tasks[_Mylast->_End++] = _Batch[_Pushed++];
+        }
+    }
+
+    _Mysize.fetch_add(_Pushed, _STD memory_order_relaxed); // published by unlock()
+    return _Pushed;
+}
+
+// FUNCTION _Injection_queue::_Pop
+size_t _Injection_queue::_Pop(_Thread_task* const _Tasks, const size_t _Count) noexcept {
+    lock_guard _Guard(_Mylock);
+    size_t _Popped = 0;
+    while (_Popped < _Count && _Myfirst) {
+        _Injection_chunk* const _Chunk = _Myfirst;
+        while (_Popped < _Count && _Chunk->_Begin < _Chunk->_End) {
+            _Tasks[_Popped++] = _Chunk->_Tasks[_Chunk->_Begin++];
+        }
+
+        if (_Chunk->_Begin < _Chunk->_End) { // the chunk still contains some tasks
+            break;
+        }
+
+        if (_Chunk == _Mylast && _Chunk->_End < _Injection_chunk::_Capacity) { // still usable
+            break;
+        }
+
+        _Myfirst = _Chunk->_Next;
+        if (!_Myfirst) {
+            _Mylast = nullptr;
+        }
+
+        if (_Myspare) { // keep at most one empty chunk
+            _Alloc _Al;
+            _Al.deallocate(_Chunk, sizeof(_Injection_chunk));
+        } else {
+            _Myspare = _Chunk;
+        }
+    }
+
+    _Mysize.fetch_sub(_Popped, _STD memory_order_relaxed);
+    return _Popped;
+}
+
+// FUNCTION _Thread_group constructor/destructor
+_Thread_group::_Thread_group() noexcept
+    : _Mytable(nullptr), _Mysize(0), _Mylock(), _Myinjected(), _Mynuma_aware(false), _Myretired(),
+      _Myoutstanding(0), _Myquiescence(0), _Mysubmitted(0) {}
+
+_Thread_group::~_Thread_group() noexcept {
+    _Alloc _Al;
+    _Member_table* _Table = _Mytable.load(_STD memory_order_relaxed);
+    while (_Table) { // release the current table and all replaced ones
+        _Member_table* const _Retired = _Table->_Retired;
+        _Al.deallocate(_Table, sizeof(_Member_table)
+            + _Table->_Capacity * sizeof(atomic<_Thread_cache*>) + (_Table->_Capacity / 32) * sizeof(atomic<uint32_t>));
+        _Table = _Retired;
+    }
+}
+
+// FUNCTION _Next_random
+static uint32_t _Next_random(uint32_t& _Seed) noexcept { // xorshift32
+    _Seed ^= _Seed << 13;
+    _Seed ^= _Seed >> 17;
+    _Seed ^= _Seed << 5;
+    return _Seed;
+}
+
+// FUNCTION _Thread_group::_Add
+_NODISCARD_ATTR bool _Thread_group::_Add(thread& _Thread) noexcept {
+    lock_guard _Guard(_Mylock);
+    _Member_table* _Table = _Mytable.load(_STD memory_order_relaxed);
+    if (!_Table || _Mysize == _Table->_Capacity) { // no space, replace the table
+        // Note: The members and the idle bits are stored in one allocation after the table.
+        //       The old table is not released, since a waking thread may still read it.
+        const size_t _Old_capacity = _Table ? _Table->_Capacity : 0;
+        const size_t _New_capacity = _Old_capacity > 0 ? _Old_capacity * 2 : 32; // multiple of 32
+        const size_t _Words        = _New_capacity / 32;
+        void* const _Raw           = _Alloc{}.allocate(sizeof(_Member_table)
+            + _New_capacity * sizeof(atomic<_Thread_cache*>) + _Words * sizeof(atomic<uint32_t>));
+        if (!_Raw) { // allocation failed
+            return false;
+        }
+
+        _Member_table* const _New_table = static_cast<_Member_table*>(_Raw);
+        _New_table->_Retired            = _Table;
+        _New_table->_Capacity           = _New_capacity;
+        _New_table->_Members            = reinterpret_cast<atomic<_Thread_cache*>*>(_New_table + 1);
+        _New_table->_Idle               = reinterpret_cast<atomic<uint32_t>*>(_New_table->_Members + _New_capacity);
+        for (size_t _Idx = 0; _Idx < _New_capacity; ++_Idx) {
+            ::new (static_cast<void*>(_New_table->_Members + _Idx)) atomic<_Thread_cache*>(
+                _Idx < _Mysize ? _Table->_Members[_Idx].load(_STD memory_order_relaxed) : nullptr);
+        }
+
+        for (size_t _Word = 0; _Word < _Words; ++_Word) {
+            ::new (static_cast<void*>(_New_table->_Idle + _Word)) atomic<uint32_t>(
+                _Word < _Old_capacity / 32 ? _Table->_Idle[_Word].load(_STD memory_order_relaxed) : 0);
+        }
+
+        _Mytable.store(_New_table, _STD memory_order_release);
+        _Table = _New_table;
+    }
+
+    _Thread_cache& _Cache = _Thread._Get_cache();
+    _Cache._Owner         = _TPLMGR addressof(_Thread);
+    _Cache._Slot          = _Mysize;
+    _Table->_Members[_Mysize].store(_TPLMGR addressof(_Cache), _STD memory_order_release);
+    if (_Cache._State.load() == thread_state::waiting) { // a new thread waits before it runs, let it be woken
+        _Table->_Idle[_Mysize / 32].fetch_or(uint32_t{1} << (_Mysize % 32), _STD memory_order_release);
+    }
+
+    ++_Mysize;
+    _Cache._Group.store(this, _STD memory_order_release);
+    return true;
+}
+
+// FUNCTION _Thread_group::_Remove
+void _Thread_group::_Remove(thread& _Thread) noexcept {
+    lock_guard _Guard(_Mylock);
+    _Thread_cache& _Cache = _Thread._Get_cache();
+    if (_Cache._Group.load(_STD memory_order_relaxed) != this) { // not a member
+        return;
+    }
+
+    if (_Cache._Slot != _No_slot) { // not withdrawn yet
+        _Erase_member(_Cache);
+    }
+
+    const thread_counters _Counters = _Cache._Counters._Read(_Precise_tick_count()); // keep the totals
+    _Myretired.executed_tasks += _Counters.executed_tasks;
+    _Myretired.submitted_tasks += _Counters.submitted_tasks;
+    _Myretired.steals += _Counters.steals;
+    _Myretired.parks += _Counters.parks;
+    _Myretired.unparks += _Counters.unparks;
+    _Myretired.busy_nanoseconds += _Counters.busy_nanoseconds;
+    _Myretired.idle_nanoseconds += _Counters.idle_nanoseconds;
+    _Myretired.queue_high_water = (_STD max)(_Myretired.queue_high_water, _Counters.queue_high_water);
+    _Cache._Group.store(nullptr, _STD memory_order_relaxed);
+    _Cache._Owner = nullptr;
+}
+
+// FUNCTION _Thread_group::_Withdraw
+void _Thread_group::_Withdraw(thread& _Thread) noexcept {
+    // Note: The withdrawn thread can't be selected, woken or stolen from, but it keeps the group,
+    //       so the tasks it still performs or discards are counted (see wait_idle()).
+    lock_guard _Guard(_Mylock);
+    _Thread_cache& _Cache = _Thread._Get_cache();
+    if (_Cache._Group.load(_STD memory_order_relaxed) != this || _Cache._Slot == _No_slot) { // not a member
+        return;
+    }
+
+    _Erase_member(_Cache);
+}
+
+// FUNCTION _Thread_group::_Erase_member
+void _Thread_group::_Erase_member(_Thread_cache& _Cache) noexcept {
+    _Member_table& _Table  = *_Mytable.load(_STD memory_order_relaxed);
+    const size_t _Slot     = _Cache._Slot;
+    const size_t _Last     = --_Mysize;
+    const uint32_t _Bit    = uint32_t{1} << (_Last % 32);
+    const bool _Last_idle  = (_Table._Idle[_Last / 32].fetch_and(~_Bit, _STD memory_order_relaxed) & _Bit) != 0;
+    const uint32_t _Target = uint32_t{1} << (_Slot % 32);
+    if (_Slot != _Last) {
+        _Thread_cache* const _Moved = _Table._Members[_Last].load(_STD memory_order_relaxed);
+        _Table._Members[_Slot].store(_Moved, _STD memory_order_release);
+        _Moved->_Slot = _Slot;
+        if (_Last_idle) {
+            _Table._Idle[_Slot / 32].fetch_or(_Target, _STD memory_order_relaxed);
+        } else {
+            _Table._Idle[_Slot / 32].fetch_and(~_Target, _STD memory_order_relaxed);
+        }
+    }
+
+    _Cache._Slot = _No_slot;
+}
+
+// FUNCTION _Thread_group::_Member_at
+_Thread_cache* _Thread_group::_Member_at(const size_t _Idx) const noexcept {
+    return _Mytable.load(_STD memory_order_relaxed)->_Members[_Idx].load(_STD memory_order_relaxed);
+}
+
+// FUNCTION _Thread_group::_Set_idle
+void _Thread_group::_Set_idle(_Thread_cache& _Cache, const bool _Idle) noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    if (_Cache._Group.load(_STD memory_order_relaxed) != this || _Cache._Slot == _No_slot) { // removed meanwhile
+        return;
+    }
+
+    atomic<uint32_t>& _Word = _Mytable.load(_STD memory_order_relaxed)->_Idle[_Cache._Slot / 32];
+    const uint32_t _Bit     = uint32_t{1} << (_Cache._Slot % 32);
+    if (_Idle) {
+        _Word.fetch_or(_Bit, _STD memory_order_relaxed);
+    } else {
+        _Word.fetch_and(~_Bit, _STD memory_order_relaxed);
+    }
+}
+
+// FUNCTION _Thread_group::_Enable_numa_placement
+void _Thread_group::_Enable_numa_placement() noexcept {
+    _Mynuma_aware = _Cpu_topology::_Get()._Node_count() > 1; // pointless with one node
+}
+
+// FUNCTION _Thread_group::_Preferred_node
+uint32_t _Thread_group::_Preferred_node(const _Thread_cache* const _Cache) const noexcept {
+    if (!_Mynuma_aware) { // all threads are equal
+        return _Any_numa_node;
+    }
+
+    if (_Cache) {
+        return _Cache->_Node;
+    }
+
+    const _Thread_cache* const _Current = _Current_thread_cache();
+    if (_Current && _Current->_Group.load(_STD memory_order_relaxed) == this) { // one of the group's threads
+        return _Current->_Node;
+    }
+
+    return _Current_numa_node();
+}
+
+// FUNCTION _Thread_group::_Select_idle_thread
+thread* _Thread_group::_Select_idle_thread() noexcept {
+    const uint32_t _Node = _Preferred_node(nullptr);
+    shared_lock_guard _Guard(_Mylock);
+    const size_t _Words = (_Mysize + 31) / 32;
+    thread* _Remote     = nullptr; // idle thread on another node
+    for (size_t _Word = 0; _Word < _Words; ++_Word) {
+        uint32_t _Bits = _Mytable.load(_STD memory_order_relaxed)->_Idle[_Word].load(_STD memory_order_relaxed);
+        while (_Bits != 0) {
+            _Thread_cache* const _Cache = _Member_at(_Word * 32 + _Bit_scan_forward(_Bits));
+            if (_Cache->_State.load(_STD memory_order_relaxed) == thread_state::waiting) {
+                if (_Node == _Any_numa_node || _Cache->_Node == _Node) {
+                    return _Cache->_Owner;
+                }
+
+                if (!_Remote) {
+                    _Remote = _Cache->_Owner;
+                }
+            }
+
+            _Bits &= _Bits - 1; // the bit was outdated or the thread is remote, try the next one
+        }
+    }
+
+    return _Remote;
+}
+
+// FUNCTION _Thread_group::_Select_less_loaded_thread
+thread* _Thread_group::_Select_less_loaded_thread() noexcept {
+    // Note: Comparing two random threads is almost as good as finding the least loaded one
+    //       (the power of two choices), but it doesn't depend on the number of threads.
+    static thread_local uint32_t _Seed = 0;
+    if (_Seed == 0) { // seed differs for each scheduling thread
+        _Seed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(_TPLMGR addressof(_Seed)) >> 4) | 1;
+    }
+
+    shared_lock_guard _Guard(_Mylock);
+    if (_Mysize == 0) {
+        return nullptr;
+    }
+
+    _Thread_cache* const _First  = _Member_at(_Next_random(_Seed) % _Mysize);
+    _Thread_cache* const _Second = _Member_at(_Next_random(_Seed) % _Mysize);
+    return _First->_Approximate_load() <= _Second->_Approximate_load() ? _First->_Owner : _Second->_Owner;
+}
+
+// FUNCTION _Thread_group::_Select_least_loaded_thread
+thread* _Thread_group::_Select_least_loaded_thread() noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    if (_Mysize == 0) {
+        return nullptr;
+    }
+
+    _Thread_cache* _Result = _Member_at(0);
+    size_t _Load           = _Result->_Approximate_load();
+    for (size_t _Idx = 1; _Idx < _Mysize && _Load > 0; ++_Idx) {
+        const size_t _Other_load = _Member_at(_Idx)->_Approximate_load(); // doesn't lock
+        if (_Other_load < _Load) {
+            _Result = _Member_at(_Idx);
+            _Load   = _Other_load;
+        }
+    }
+
+    return _Result->_Owner;
+}
+
+// FUNCTION _Thread_group::_Select_thread_at
+thread* _Thread_group::_Select_thread_at(const size_t _Hint) noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    return _Mysize > 0 ? _Member_at(_Hint % _Mysize)->_Owner : nullptr;
+}
+
+// FUNCTION _Thread_group::_Inject
+_NODISCARD_ATTR bool _Thread_group::_Inject(const _Thread_task& _Task) noexcept {
+    if (!_Myinjected._Push(_Task)) {
+        return false;
+    }
+
+    _Wake_one(nullptr);
+    return true;
+}
+
+// FUNCTION _Thread_group::_Inject_many
+size_t _Thread_group::_Inject_many(const _Task_batch& _Batch) noexcept {
+    // Note: The whole batch is appended under one lock. Each woken thread takes a part of it
+    //       and wakes another thread if some tasks are left (see _Refill()), so waking more threads
+    //       than there are tasks would be pointless.
+    const size_t _Pushed = _Myinjected._Push_many(_Batch);
+    if (_Pushed > 0) {
+        _Wake(_Pushed, nullptr);
+    }
+
+    return _Pushed;
+}
+
+// FUNCTION _Thread_group::_Refill
+_NODISCARD_ATTR bool _Thread_group::_Refill(_Thread_cache& _Cache, _Thread_task& _Task) noexcept {
+    if (_Myinjected._Empty()) {
+        return false;
+    }
+
+    // Note: The thread takes half of the injected tasks (up to _Max_refill), the rest is left
+    //       for other threads. Taken tasks can still be stolen from the thread's deque.
+    size_t _Count = (_STD min)((_Myinjected._Size() + 1) / 2, _Max_refill);
+    if (_Count > 1 && !_Cache._Deque._Reserve(_Count - 1)) { // no space for more tasks
+        _Count = 1;
+    }
+
+    _Thread_task _Batch[_Max_refill];
+    _Count = _Myinjected._Pop(_Batch, _Count);
+    if (_Count == 0) { // other threads were faster
+        return false;
+    }
+
+    _Task = _Batch[0];
+    if (_Count > 1) {
+        for (size_t _Idx = _Count - 1; _Idx > 0; --_Idx) { // the oldest task will be popped first
+            (void) _Cache._Deque._Push(_Batch[_Idx]); // cannot fail, the space is reserved
+        }
+
+        _Cache._Counters._Observe(_Cache._Deque._Size() + 1);
+
+        _Wake_one(_TPLMGR addressof(_Cache)); // let another waiting thread steal some of them
+    }
+
+    return true;
+}
+
+// FUNCTION _Thread_group::_Injected_tasks
+size_t _Thread_group::_Injected_tasks() const noexcept {
+    return _Myinjected._Size();
+}
+
+// FUNCTION _Thread_group::_Outstanding_tasks
+size_t _Thread_group::_Outstanding_tasks() const noexcept {
+    return _Myoutstanding.load(_STD memory_order_relaxed);
+}
+
+// FUNCTION _Thread_group::_Completed_tasks
+uint64_t _Thread_group::_Completed_tasks() noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    uint64_t _Result = _Myretired.executed_tasks;
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        _Result += _Member_at(_Idx)->_Counters._Executed.load(_STD memory_order_relaxed);
+    }
+
+    return _Result;
+}
+
+// FUNCTION _Thread_group::_Snapshot
+thread_counters _Thread_group::_Snapshot() noexcept {
+    // Note: The threads never lock the group exclusively, so the shared lock only waits for
+    //       threads being added or removed. No thread's queue is locked.
+    const uint64_t _Now = _Precise_tick_count();
+    shared_lock_guard _Guard(_Mylock);
+    thread_counters _Result = _Myretired;
+    _Result.submitted_tasks += _Mysubmitted.load(_STD memory_order_relaxed);
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        const thread_counters _Counters = _Member_at(_Idx)->_Counters._Read(_Now);
+        _Result.executed_tasks += _Counters.executed_tasks;
+        _Result.submitted_tasks += _Counters.submitted_tasks;
+        _Result.steals += _Counters.steals;
+        _Result.parks += _Counters.parks;
+        _Result.unparks += _Counters.unparks;
+        _Result.busy_nanoseconds += _Counters.busy_nanoseconds;
+        _Result.idle_nanoseconds += _Counters.idle_nanoseconds;
+        _Result.queue_high_water = (_STD max)(_Result.queue_high_water, _Counters.queue_high_water);
+    }
+
+    return _Result;
+}
+
+// FUNCTION _Thread_group::_Snapshot_threads
+size_t _Thread_group::_Snapshot_threads(thread_counters* const _Counters, const size_t _Count) noexcept {
+    const uint64_t _Now = _Precise_tick_count();
+    shared_lock_guard _Guard(_Mylock);
+    const size_t _Copied = (_STD min)(_Count, _Mysize);
+    for (size_t _Idx = 0; _Idx < _Copied; ++_Idx) {
+        _Counters[_Idx] = _Member_at(_Idx)->_Counters._Read(_Now);
+    }
+
+    return _Mysize;
+}
+
+// FUNCTION _Thread_group::_Cancel_injected_tasks
+void _Thread_group::_Cancel_injected_tasks() noexcept {
+    _Finish_tasks(_Myinjected._Clear());
+}
+
+// FUNCTION _Thread_group::_Begin_tasks
+void _Thread_group::_Begin_tasks(const size_t _Count) noexcept {
+    _Myoutstanding.fetch_add(_Count, _STD memory_order_relaxed);
+    _Thread_cache* const _Cache = _Current_cache;
+    if (_Cache && _Cache->_Group.load(_STD memory_order_relaxed) == this) { // one of the group's threads
+        _Thread_counters::_Add(_Cache->_Counters._Submitted, _Count);
+    } else { // shares the cache line with _Myoutstanding, which has just been written
+        _Mysubmitted.fetch_add(_Count, _STD memory_order_relaxed);
+    }
+}
+
+// FUNCTION _Thread_group::_Finish_tasks
+void _Thread_group::_Finish_tasks(const size_t _Count) noexcept {
+    if (_Count == 0 || _Myoutstanding.fetch_sub(_Count, _STD memory_order_seq_cst) != _Count) {
+        return; // some tasks are still outstanding
+    }
+
+    // Note: The counter must be decremented before the flag is checked, see _Wait_idle().
+    uint32_t _Word = _Myquiescence.load(_STD memory_order_seq_cst);
+    while (_Word & 1) { // some thread waits, start a new generation and wake all waiters
+        if (_Myquiescence.compare_exchange_weak(_Word, (_Word & ~uint32_t{1}) + 2, _STD memory_order_seq_cst)) {
+            _Wake_by_address_all(_Myquiescence);
+            break;
+        }
+    }
+}
+
+// FUNCTION _Thread_group::_Wait_idle
+bool _Thread_group::_Wait_idle(const bool _Timed, const uint32_t _Milliseconds) noexcept {
+    const uint64_t _Deadline = _Timed ? _Tick_count() + _Milliseconds : 0;
+    for (;;) {
+        if (_Myoutstanding.load(_STD memory_order_seq_cst) == 0) {
+            return true;
+        }
+
+        uint32_t _Word = _Myquiescence.load(_STD memory_order_seq_cst);
+        if (!(_Word & 1)) { // tell the finishing thread to wake this one
+            if (!_Myquiescence.compare_exchange_weak(_Word, _Word | 1, _STD memory_order_seq_cst)) {
+                continue;
+            }
+
+            _Word |= 1;
+        }
+
+        // Note: The flag must be set before the counter is checked again. Either the last finishing
+        //       thread sees the flag, or this thread sees that nothing is outstanding.
+        if (_Myoutstanding.load(_STD memory_order_seq_cst) == 0) {
+            return true;
+        }
+
+        if (!_Timed) {
+            _Wait_on_address(_Myquiescence, _Word);
+            continue;
+        }
+
+        const uint64_t _Now = _Tick_count();
+        if (_Now >= _Deadline
+            || !_Wait_on_address_for(_Myquiescence, _Word, static_cast<uint32_t>(_Deadline - _Now))) {
+            return _Myoutstanding.load(_STD memory_order_seq_cst) == 0;
+        }
+    }
+}
+
+// FUNCTION _Thread_group::_Steal
+_NODISCARD_ATTR bool _Thread_group::_Steal(_Thread_cache& _Thief, _Thread_task& _Task) noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    if (_Mysize < 2) { // nobody to steal from
+        return false;
+    }
+
+    // Note: Each thief starts at a different (pseudo-random) victim, so thieves rarely collide.
+    //       If NUMA placement is enabled, victims on the thief's node are tried first.
+    const uint32_t _Node = _Preferred_node(_TPLMGR addressof(_Thief));
+    const size_t _First  = static_cast<size_t>(_Next_random(_Thief._Seed)) % _Mysize;
+    const size_t _Passes = _Node != _Any_numa_node ? 2 : 1;
+    for (size_t _Off = 0; _Off < _Passes * _Mysize; ++_Off) {
+        _Thread_cache* const _Victim = _Member_at((_First + _Off) % _Mysize);
+        if (_Victim == _TPLMGR addressof(_Thief)) {
+            continue;
+        }
+
+        if (_Passes == 2 && (_Victim->_Node == _Node) != (_Off < _Mysize)) { // local first, then remote
+            continue;
+        }
+
+        const size_t _Available = _Victim->_Deque._Size();
+        if (_Available == 0 || !_Victim->_Deque._Steal(_Task)) { // nothing to steal or lost the race
+            continue;
+        }
+
+        // steal half of the victim's tasks, keep the rest in the thief's deque
+        size_t _Count = (_Available + 1) / 2 - 1; // the first task is already stolen
+        if (_Count > 0 && _Thief._Deque._Reserve(_Count)) {
+            _Thread_task _Next;
+            size_t _Moved = 0;
+            for (; _Moved < _Count && _Victim->_Deque._Steal(_Next); ++_Moved) {
+                (void) _Thief._Deque._Push(_Next); // cannot fail, the space is reserved
+            }
+
+            if (_Moved > 0) { // let another waiting thread steal from the thief
+                _STD atomic_thread_fence(_STD memory_order_seq_cst);
+                _Wake_idle(1, _TPLMGR addressof(_Thief), _Node);
+            }
+
+            _Thief._Counters._Observe(_Moved + 1);
+        }
+
+        _Thread_counters::_Add(_Thief._Counters._Steals, 1);
+        return true;
+    }
+
+    return false;
+}
+
+// FUNCTION _Thread_group::_Has_stealable_tasks
+bool _Thread_group::_Has_stealable_tasks(const _Thread_cache& _Thief) noexcept {
+    if (!_Myinjected._Empty()) {
+        return true;
+    }
+
+    shared_lock_guard _Guard(_Mylock);
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        const _Thread_cache* const _Cache = _Member_at(_Idx);
+        if (_Cache != _TPLMGR addressof(_Thief) && !_Cache->_Deque._Empty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// FUNCTION _Thread_group::_Wake_one
+void _Thread_group::_Wake_one(const _Thread_cache* const _Except) noexcept {
+    // Note: The caller has just pushed a task, the state of other threads must be loaded after that.
+    //       Paired with the fence in thread::_Schedule_handler().
+    _STD atomic_thread_fence(_STD memory_order_seq_cst);
+    _Wake_idle(1, _Except, _Preferred_node(_Except));
+}
+
+// FUNCTION _Thread_group::_Wake
+void _Thread_group::_Wake(const size_t _Count, const _Thread_cache* const _Except) noexcept {
+    // Note: The caller has just pushed some tasks, see _Wake_one() for details.
+    _STD atomic_thread_fence(_STD memory_order_seq_cst);
+    _Wake_idle(_Count, _Except, _Preferred_node(_Except));
+}
+
+// FUNCTION _Thread_group::_Wake_idle
+void _Thread_group::_Wake_idle(size_t _Count, const _Thread_cache* const _Except, const uint32_t _Node) noexcept {
+    // Note: Only threads whose idle bits are set are tried, so nothing is scanned if no thread waits.
+    //       The group's lock isn't taken. A stale table or member makes the wake-up spurious at worst,
+    //       since the threads' records outlive the group's use. A thread sets its bit before it checks
+    //       the pending tasks for the last time (see thread::_Schedule_handler()).
+    //       Threads on _Node are woken first (if it's not _Any_numa_node), then the other ones.
+    const _Member_table* const _Table = _Mytable.load(_STD memory_order_acquire);
+    if (!_Table) { // no members
+        return;
+    }
+
+    const size_t _Words = _Table->_Capacity / 32;
+    for (bool _Local = _Node != _Any_numa_node;; _Local = false) {
+        for (size_t _Word = 0; _Word < _Words && _Count > 0; ++_Word) {
+            uint32_t _Bits = _Table->_Idle[_Word].load(_STD memory_order_acquire);
+            for (; _Bits != 0 && _Count > 0; _Bits &= _Bits - 1) {
+                _Thread_cache* const _Cache =
+                    _Table->_Members[_Word * 32 + _Bit_scan_forward(_Bits)].load(_STD memory_order_acquire);
+                if (!_Cache || _Cache == _Except || (_Local && _Cache->_Node != _Node)) {
+                    continue;
+                }
+
+                if (_Cache->_State.load() == thread_state::waiting
+                    && _Cache->_Transition(thread_state::waiting, thread_state::working)) {
+                    --_Count;
+                }
+            }
+        }
+
+        if (!_Local || _Count == 0) {
+            break;
+        }
+    }
+}
+
+// FUNCTION _Has_pending_tasks
+static bool _Has_pending_tasks(_Thread_cache& _Cache) noexcept {
+    if (!_Cache._Queue.empty()) {
+        return true;
+    }
+
+    _Thread_group* const _Group = _Cache._Group.load(_STD memory_order_acquire);
+    return _Group && _Group->_Has_stealable_tasks(_Cache);
+}
+
+// STRUCT _Task_buffer
+struct _Task_buffer { // tasks taken from the thread's queue at once, used only by the thread itself
+    static constexpr size_t _Capacity = 8;
+
+    _Thread_task _Tasks[_Capacity];
+    size_t _Next; // index of the next task
+    size_t _Size; // number of taken tasks
+    uint32_t _Epoch; // _Thread_cache::_Cancel_epoch when the tasks were taken
+};
+
+// FUNCTION _Discard_buffered_tasks
+static void _Discard_buffered_tasks(_Thread_cache& _Cache, _Task_buffer& _Buffer) noexcept {
+    _Thread_group* const _Group = _Cache._Group.load(_STD memory_order_acquire);
+    if (_Group) { // the tasks will never be performed
+        _Group->_Finish_tasks(_Buffer._Size - _Buffer._Next);
+    }
+
+    _Buffer._Next = _Buffer._Size;
+}
+
+// FUNCTION _Next_buffered_task
+static bool _Next_buffered_task(_Thread_cache& _Cache, _Task_buffer& _Buffer, _Thread_task& _Task) noexcept {
+    // Note: The queue is locked once per _Task_buffer::_Capacity tasks instead of twice per task.
+    //       A task with higher priority scheduled meanwhile waits for at most that many tasks.
+    if (_Buffer._Next < _Buffer._Size
+        && _Cache._Cancel_epoch.load(_STD memory_order_relaxed) != _Buffer._Epoch) { // tasks cancelled
+        _Discard_buffered_tasks(_Cache, _Buffer);
+    }
+
+    if (_Buffer._Next == _Buffer._Size) { // take the next batch of tasks with the highest priority
+        _Buffer._Size  = _Cache._Queue.pop_many(_Buffer._Tasks, _Task_buffer::_Capacity);
+        _Buffer._Next  = 0;
+        _Buffer._Epoch = _Cache._Cancel_epoch.load(_STD memory_order_relaxed); // ordered by the lock
+        if (_Buffer._Size == 0) {
+            _Cache._Buffered.store(0, _STD memory_order_relaxed);
+            return false;
+        }
+
+        // Note: The queue's size is read only if it may hold more tasks, since it's written
+        //       by the scheduling threads.
+        _Cache._Counters._Observe(_Buffer._Size == _Task_buffer::_Capacity
+            ? _Buffer._Size + _Cache._Queue.approximate_size() : _Buffer._Size);
+    }
+
+    _Task = _Buffer._Tasks[_Buffer._Next++];
+    _Cache._Buffered.store(_Buffer._Size - _Buffer._Next, _STD memory_order_relaxed);
+    return true;
+}
+
+// FUNCTION _Next_task
+static bool _Next_task(_Thread_cache& _Cache, _Task_buffer& _Buffer, _Thread_task& _Task) noexcept {
+    if (_Cache._Deque._Pop(_Task)) { // the most recently scheduled own task
+        return true;
+    }
+
+    if (_Next_buffered_task(_Cache, _Buffer, _Task)) { // the task with the highest priority
+        return true;
+    }
+
+    _Thread_group* const _Group = _Cache._Group.load(_STD memory_order_acquire);
+    if (!_Group) { // not in the thread-pool
+        return false;
+    }
+
+    return _Group->_Refill(_Cache, _Task) // the oldest task scheduled by another thread
+        || _Group->_Steal(_Cache, _Task); // the oldest task of another thread
+}
+
 // FUNCTION thread constructors/destructor
 thread::thread() noexcept : _Myid(0), _Mycache(thread_state::waiting), _Mystack() {
     _Attach();
@@ -68,13 +1089,29 @@ thread::thread(thread&& _Other) noexcept
 
 thread::thread(const task _Task, void* const _Data) noexcept
     : _Myimpl(nullptr), _Myid(0), _Mycache(thread_state::working), _Mystack() {
-    if (_Mycache._Queue.push(_Thread_task{_Task, _Data})) { // try schedule an immediate task
+    if (_Mycache._Queue.push(_Thread_task{_Task, _Data, task_priority::normal},
+        static_cast<size_t>(task_priority::normal))) { // try schedule an immediate task
         if (!_Attach()) {
             _Mycache._Queue.clear();
         }
     }
 }
 
+thread::thread(const thread_affinity _Affinity, const uint32_t _Binding) noexcept
+    : _Myid(0), _Mycache(thread_state::waiting), _Mystack() {
+    // Note: The node is known before the thread starts, so other threads can read it without
+    //       synchronization.
+    _Mycache._Affinity = _Affinity;
+    _Mycache._Binding  = _Binding;
+    if (_Affinity == thread_affinity::cpu) {
+        _Mycache._Node = _Cpu_topology::_Get()._Node_of(_Binding);
+    } else if (_Affinity == thread_affinity::numa_node) {
+        _Mycache._Node = _Binding;
+    }
+
+    _Attach();
+}
+
 thread::~thread() noexcept {
     (void) terminate(); // wait for the current task to finish, discard the rest
 }
@@ -96,20 +1133,71 @@ thread& thread::operator=(thread&& _Other) noexcept {
 // FUNCTION thread::_Schedule_handler
 unsigned long __stdcall thread::_Schedule_handler(void* const _Data) noexcept {
     _Thread_cache* const _Cache = static_cast<_Thread_cache*>(_Data);
+    _Current_cache              = _Cache;
+    if (_Cache->_Affinity != thread_affinity::none) { // bind before any task is performed
+        _Cache->_Bind();
+    }
+
+    _Task_buffer _Buffer        = {};
+    _Thread_task _Task;
+    _Cache->_Counters._Switch(false, _Precise_tick_count());
     for (;;) {
-        switch (_Cache->_State.load(_STD memory_order_relaxed)) {
-        case thread_state::terminated: // try terminate itself
-            _Terminate_current_thread();
-            break;
-        case thread_state::waiting: // try suspend itself
-            _Suspend_current_thread();
+        switch (_Cache->_State.load(_STD memory_order_acquire)) {
+        case thread_state::terminated: // terminate itself
+            _Discard_buffered_tasks(*_Cache, _Buffer);
+            _Cache->_Counters._Stop(_Precise_tick_count());
+            _Current_cache = nullptr;
+            return 0;
+        case thread_state::waiting: // wait until resumed or terminated
+        {
+            _Thread_group* const _Group = _Cache->_Group.load(_STD memory_order_acquire);
+            if (_Group) { // let the thread-pool find this thread without scanning
+                _Group->_Set_idle(*_Cache, true);
+            }
+
+            _Cache->_Idle_since.store(_Tick_count(), _STD memory_order_relaxed);
+            _Cache->_Counters._Switch(true, _Precise_tick_count());
+            _Cache->_Wait_while(thread_state::waiting);
+            _Cache->_Counters._Switch(false, _Precise_tick_count());
+            _Cache->_Idle_since.store(0, _STD memory_order_relaxed);
+            if (_Group) {
+                _Group->_Set_idle(*_Cache, false);
+            }
+
             break;
+        }
         case thread_state::working: // try perform next task
-            if (!_Cache->_Queue.empty()) {
-                const _Thread_task& _Task = _Cache->_Queue.pop();
-                (*_Task._Func)(_Task._Data);
+            if (_Next_task(*_Cache, _Buffer, _Task)) {
+                // Note: The group must be loaded before the task is invoked, the thread may be
+                //       removed from the pool meanwhile, but the task has been counted anyway.
+                _Thread_group* const _Group = _Cache->_Group.load(_STD memory_order_acquire);
+                _Task._Invoke();
+                _Thread_counters::_Add(_Cache->_Counters._Executed, 1);
+                if (_Group) { // let wait_idle() know
+                    _Group->_Finish_tasks(1);
+                }
             } else { // nothing to do, wait for any task
-                _Cache->_State.store(thread_state::waiting, _STD memory_order_relaxed);
+                thread_state _Expected = thread_state::working;
+                if (_Cache->_State.compare_exchange_strong(_Expected, thread_state::waiting)) {
+                    // Note: A task may have been pushed after _Next_task() by a thread that
+                    //       still observed thread_state::working, so it did not resume this thread.
+                    //       Paired with the fences in schedule_task() and _Thread_group::_Wake_one().
+                    //       The idle bit is set before the fence, since the group only wakes threads
+                    //       whose bits are set.
+                    _Thread_group* const _Group = _Cache->_Group.load(_STD memory_order_acquire);
+                    if (_Group) {
+                        _Group->_Set_idle(*_Cache, true);
+                    }
+
+                    _STD atomic_thread_fence(_STD memory_order_seq_cst);
+                    if (_Has_pending_tasks(*_Cache)) {
+                        _Expected = thread_state::waiting;
+                        (void) _Cache->_State.compare_exchange_strong(_Expected, thread_state::working);
+                        if (_Group) {
+                            _Group->_Set_idle(*_Cache, false);
+                        }
+                    }
+                }
             }
 
             break;
@@ -148,17 +1236,16 @@ void thread::_Set_state(const thread_state _New_state) noexcept {
 // FUNCTION thread::_Erase_data
 void thread::_Erase_data() noexcept {
     _Set_state(thread_state::terminated);
-    _Mycache._Queue.clear(); // clear task queue
+    cancel_all_pending_tasks(); // clear task queues
     _Mystack._Clear(); // clear event callbacks
-    ::CloseHandle(_Myimpl); // close thread handle
+    _Close_thread(_Myimpl); // close thread handle
     _Myimpl = nullptr;
     _Myid   = 0;
 }
 
 // FUNCTION thread::_Attach
 bool thread::_Attach() noexcept {
-    _Myimpl = ::CreateThread(nullptr, 0, _Schedule_handler,
-        _TPLMGR addressof(_Mycache), 0, reinterpret_cast<unsigned long*>(&_Myid));
+    _Myimpl = _Create_thread(_Schedule_handler, _TPLMGR addressof(_Mycache), _TPLMGR addressof(_Myid));
     if (_Myimpl) { // attached a new thread
         return true;
     } else { // failed to attach a new thread
@@ -174,18 +1261,8 @@ void thread::_Tidy() noexcept {
         (void) suspend(); // must be suspended
     }
 
-    _Set_state(thread_state::terminated);
+    _Mycache._Force_transition(thread_state::terminated); // wake the thread, so it can terminate
     _Invoke_callbacks(terminate_event);
-    
-    // Note: We cannot use resume() here, because it will set the state to thread_state::working.
-    //       The thread would continue doing its task.
-    (void) _Resume_thread(_Myimpl);
-}
-
-// FUNCTION thread::_Has_higher_priority::operator()
-bool thread::_Has_higher_priority::operator()(
-    const _Thread_task& _Left, const _Thread_task& _Right) const noexcept {
-    return static_cast<uint8_t>(_Left._Priority) > static_cast<uint8_t>(_Right._Priority);
 }
 
 // FUNCTION thread::hardware_concurrency
@@ -210,6 +1287,11 @@ const thread::id thread::get_id() const noexcept {
     return _Myid;
 }
 
+// FUNCTION thread::current_id
+thread::id thread::current_id() noexcept {
+    return _Current_thread_id();
+}
+
 // FUNCTION thread::native_handle
 const thread::native_handle_type thread::native_handle() const noexcept {
     return _Myimpl;
@@ -222,56 +1304,110 @@ thread_state thread::state() const noexcept {
 
 // FUNCTION thread::pending_tasks
 size_t thread::pending_tasks() const noexcept {
-    return _Mycache._Queue.size();
+    return _Mycache._Queue.size() + _Mycache._Buffered.load(_STD memory_order_relaxed)
+        + _Mycache._Deque._Size();
+}
+
+// FUNCTION thread::spin_count
+size_t thread::spin_count() const noexcept {
+    return _Mycache._Spin_count.load(_STD memory_order_relaxed);
+}
+
+// FUNCTION thread::set_spin_count
+void thread::set_spin_count(const size_t _Count) noexcept {
+    _Mycache._Spin_count.store(
+        static_cast<uint32_t>((_STD min)(_Count, size_t{0xFFFF'FFFF})), _STD memory_order_relaxed);
 }
 
 // FUNCTION thread::cancel_all_pending_tasks
 void thread::cancel_all_pending_tasks() noexcept {
-    _Mycache._Queue.clear();
+    // Note: The epoch must be incremented before the queue is cleared, so the thread discards
+    //       the tasks it has already taken, but keeps the ones scheduled after the cancellation.
+    _Mycache._Cancel_epoch.fetch_add(1, _STD memory_order_relaxed);
+    _Mycache._Buffered.store(0, _STD memory_order_relaxed);
+    size_t _Cancelled = _Mycache._Queue.clear();
+    _Thread_task _Task;
+    while (!_Mycache._Deque._Empty()) { // only the thread itself can pop, steal instead
+        if (_Mycache._Deque._Steal(_Task)) {
+            ++_Cancelled;
+        }
+    }
+
+    _Thread_group* const _Group = _Mycache._Group.load(_STD memory_order_acquire);
+    if (_Group) { // let wait_idle() know
+        _Group->_Finish_tasks(_Cancelled);
+    }
 }
 
 // FUNCTION thread::schedule_task
 _NODISCARD_ATTR bool thread::schedule_task(const task _Task, void* const _Data) noexcept {
-    const thread_state _State = state();
-    if (_State == thread_state::terminated || _Mycache._Queue.full()) {
+    return _Schedule_task(_Thread_task{_Task, _Data, task_priority::normal});
+}
+
+_NODISCARD_ATTR bool thread::schedule_task(
+    const task _Task, void* const _Data, const task_priority _Priority) noexcept {
+    return _Schedule_task(_Thread_task{_Task, _Data, _Priority});
+}
+
+// FUNCTION thread::_Schedule_task
+_NODISCARD_ATTR bool thread::_Schedule_task(const _Thread_task& _Task) noexcept {
+    if (state() == thread_state::terminated || _Mycache._Queue.full()) {
         return false;
     }
 
-    if (!_Mycache._Queue.push_with_priority(
-        _Thread_task{_Task, _Data, task_priority::normal}, _Has_higher_priority{})) {
+    // Note: Each priority has its own FIFO queue, so the push doesn't depend on the number of
+    //       pending tasks. Tasks with the same priority are performed in scheduling order.
+    if (!_Mycache._Queue.push(_Task, static_cast<size_t>(_Task._Priority))) {
         return false;
     }
-    
-    if (_State != thread_state::working) { // notify waiting thread
+
+    // Note: The state must be loaded after the push, see _Schedule_handler() for details.
+    _STD atomic_thread_fence(_STD memory_order_seq_cst);
+    if (state() == thread_state::waiting) { // notify waiting thread
         (void) resume();
     }
 
     return true;
 }
 
-_NODISCARD_ATTR bool thread::schedule_task(
-    const task _Task, void* const _Data, const task_priority _Priority) noexcept {
-    const thread_state _State = state();
-    if (_State == thread_state::terminated || _Mycache._Queue.full()) {
-        return false;
+// FUNCTION thread::_Schedule_tasks
+size_t thread::_Schedule_tasks(const _Task_batch& _Batch) noexcept {
+    if (state() == thread_state::terminated) {
+        return 0;
     }
 
-    if (_Priority == task_priority::idle) { // always at the end
-        if (!_Mycache._Queue.push(_Thread_task{_Task, _Data, task_priority::idle})) {
-            return false;
-        }
-    } else { // position not specified
-        if (!_Mycache._Queue.push_with_priority(
-            _Thread_task{_Task, _Data, _Priority}, _Has_higher_priority{})) {
-            return false;
+    const size_t _Pushed = _Mycache._Queue.push_many(
+        _Batch, _Batch._Count, static_cast<size_t>(_Batch._Priority));
+    if (_Pushed > 0) {
+        // Note: The state must be loaded after the push, see _Schedule_handler() for details.
+        _STD atomic_thread_fence(_STD memory_order_seq_cst);
+        if (state() == thread_state::waiting) { // notify waiting thread
+            (void) resume();
         }
     }
 
-    if (_State != thread_state::working) { // notify waiting thread
-        (void) resume();
-    }
+    return _Pushed;
+}
 
-    return true;
+// FUNCTION thread::_Get_cache
+_Thread_cache& thread::_Get_cache() noexcept {
+    return _Mycache;
+}
+
+// FUNCTION thread::_Retire
+_NODISCARD_ATTR bool thread::_Retire() noexcept {
+    // Note: The caller must ensure that no task can be scheduled to this thread meanwhile.
+    //       A waiting thread that has no pending tasks is not performing any task, so it can be
+    //       terminated without suspending it first. If it's resumed meanwhile, the transition fails.
+    return joinable() && pending_tasks() == 0
+        && _Mycache._Transition(thread_state::waiting, thread_state::terminated);
+}
+
+// FUNCTION thread::_Join_retired
+void thread::_Join_retired() noexcept {
+    _Invoke_callbacks(terminate_event);
+    _Wait_for_thread(_Myimpl); // joinable() is already false
+    _Erase_data();
 }
 
 // FUNCTION thread::terminate
@@ -295,14 +1431,10 @@ _NODISCARD_ATTR bool thread::suspend() noexcept {
         return false;
     }
 
+    // Note: The thread finishes its current task and then waits until resumed.
     _Invoke_callbacks(suspend_event);
-    _Set_state(thread_state::waiting);
-    if (_Suspend_thread(_Myimpl)) {
-        return true;
-    } else { // failed to suspend the thread, restore an old state
-        _Set_state(thread_state::working);
-        return false;
-    }
+    thread_state _Expected = thread_state::working;
+    return _Mycache._State.compare_exchange_strong(_Expected, thread_state::waiting);
 }
 
 // FUNCTION thread::resume
@@ -312,13 +1444,7 @@ _NODISCARD_ATTR bool thread::resume() noexcept {
     }
 
     _Invoke_callbacks(resume_event);
-    _Set_state(thread_state::working);
-    if (_Resume_thread(_Myimpl)) {
-        return true;
-    } else { // failed to resume the thread, restore an old state
-        _Set_state(thread_state::waiting);
-        return false;
-    }
+    return _Mycache._Transition(thread_state::waiting, thread_state::working);
 }
 _TPLMGR_END
 
@@ -8,15 +8,19 @@
 #define _TPLMGR_THREAD_HPP_
 #include <tplmgr/core.hpp>
 #if _TPLMGR_PREPROCESSOR_GUARD
-#include <tplmgr/shared_queue.hpp>
+#include <tplmgr/mpsc_queue.hpp>
 #include <tplmgr/stack.hpp>
+#include <tplmgr/topology.hpp>
 #include <tplmgr/utils.hpp>
+#include <tplmgr/work_stealing_deque.hpp>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#ifdef _WIN32
 #include <handleapi.h>
 #include <processthreadsapi.h>
 #include <sysinfoapi.h>
+#endif // _WIN32
 #include <utility>
 
 _TPLMGR_BEGIN
@@ -26,20 +30,15 @@ using _STD atomic;
 // FUNCTION _Hardware_concurrency
 extern size_t _Hardware_concurrency() noexcept;
 
+// FUNCTION _Create_thread
+_NODISCARD_ATTR extern void* _Create_thread(
+    unsigned long(__stdcall* const _Routine)(void*), void* const _Data, unsigned int* const _Id) noexcept;
+
 // FUNCTION _Wait_for_thread
 extern void _Wait_for_thread(void* const _Handle) noexcept;
 
-// FUNCTION _Terminate_current_thread
-extern void _Terminate_current_thread() noexcept;
-
-// FUNCTION _Suspend_current_thread
-extern void _Suspend_current_thread() noexcept;
-
-// FUNCTION _Suspend_thread
-extern _NODISCARD_ATTR bool _Suspend_thread(void* const _Handle) noexcept;
-
-// FUNCTION _Resume_thread
-extern _NODISCARD_ATTR bool _Resume_thread(void* const _Handle) noexcept;
+// FUNCTION _Close_thread
+extern void _Close_thread(void* const _Handle) noexcept;
 
 // ENUM CLASS thread_state
 enum class thread_state : unsigned char {
@@ -57,13 +56,116 @@ enum class task_priority : unsigned char {
     real_time
 };
 
+// CONSTANT _Task_priority_levels
+_INLINE_VARIABLE constexpr size_t _Task_priority_levels = static_cast<size_t>(task_priority::real_time) + 1;
+
+// CONSTANT _Inline_task_size
+_INLINE_VARIABLE constexpr size_t _Inline_task_size = 48; // max size of a callable stored in the task
+
 // STRUCT _Thread_task
-struct _Thread_task {
+struct _Thread_task { // type-erased task, small callables are stored inline
     using _Fn = void(__STDCALL_OR_CDECL*)(void*);
 
+    // Note: Tasks are copied between queues as raw bytes and never destroyed, so only trivially
+    //       copyable and destructible callables may be stored in _Storage. The task occupies
+    //       exactly one cache line, larger callables must be allocated by the scheduling side.
     _Fn _Func;
-    void* _Data;
+    union {
+        void* _Data; // passed to _Func (if _Inline is false)
+        alignas(void*) unsigned char _Storage[_Inline_task_size]; // passed to _Func (if _Inline is true)
+    };
+    task_priority _Priority;
+    bool _Inline = false;
+
+    void _Invoke() noexcept {
+        (*_Func)(_Inline ? static_cast<void*>(_Storage) : _Data);
+    }
+};
+
+// STRUCT _Task_batch
+struct _Task_batch { // tasks scheduled at once, with own functions or with a common one
+    const _Thread_task::_Fn* _Funcs; // function of each task (optional)
+    _Thread_task::_Fn _Func; // function of all tasks, used if _Funcs is null
+    void* const* _Data; // data of each task (optional)
+    size_t _Count;
     task_priority _Priority;
+
+    _Thread_task operator[](const size_t _Idx) const noexcept {
+        return _Thread_task{_Funcs ? _Funcs[_Idx] : _Func, _Data ? _Data[_Idx] : nullptr, _Priority};
+    }
+
+    // returns _Size tasks starting at _First
+    _Task_batch _Slice(const size_t _First, const size_t _Size) const noexcept {
+        return _Task_batch{_Funcs ? _Funcs + _First : nullptr, _Func,
+            _Data ? _Data + _First : nullptr, _Size, _Priority};
+    }
+};
+
+// CLASS _Thread_group
+class _Thread_group;
+
+// CLASS thread
+class thread;
+
+// CONSTANT _Default_spin_count
+_INLINE_VARIABLE constexpr uint32_t _Default_spin_count = 128; // spins before the thread blocks
+
+// STRUCT thread_counters
+struct thread_counters { // counters of a thread (or their sum), see thread_pool::snapshot()
+    uint64_t executed_tasks; // tasks performed by the thread
+    uint64_t submitted_tasks; // tasks scheduled to the thread-pool by the thread
+    uint64_t steals; // successful steals from other threads
+    uint64_t parks; // times the thread blocked until resumed
+    uint64_t unparks; // times the thread returned from blocking (including spurious wakeups)
+    uint64_t busy_nanoseconds; // time spent working (performing or looking for tasks)
+    uint64_t idle_nanoseconds; // time spent waiting
+    size_t queue_high_water; // the most pending tasks observed by the thread
+};
+
+// STRUCT _Thread_counters
+struct alignas(_Cache_line_size) _Thread_counters { // written only by the thread, read by anyone
+    _Thread_counters() noexcept;
+
+    _Thread_counters(const _Thread_counters&) = delete;
+    _Thread_counters& operator=(const _Thread_counters&) = delete;
+
+    // adds _Count to the counter (only the thread writes, so no read-modify-write is needed)
+    static void _Add(atomic<uint64_t>& _Counter, const uint64_t _Count) noexcept {
+        _Counter.store(_Counter.load(_STD memory_order_relaxed) + _Count, _STD memory_order_relaxed);
+    }
+
+    // raises the high-water mark to _Pending if it's higher
+    void _Observe(const size_t _Pending) noexcept {
+        if (_Pending > _High_water.load(_STD memory_order_relaxed)) {
+            _High_water.store(_Pending, _STD memory_order_relaxed);
+        }
+    }
+
+    // starts a new busy or idle period at _Now (called by the thread)
+    void _Switch(const bool _Idle_period, const uint64_t _Now) noexcept;
+
+    // ends the current period at _Now, no time is counted afterwards (called by the thread)
+    void _Stop(const uint64_t _Now) noexcept;
+
+    // reads all counters without blocking the thread, the current period ends at _Now
+    thread_counters _Read(const uint64_t _Now) const noexcept;
+
+    // closes the current period at _Now, the next one starts at _Start (0 if none)
+    void _Begin_period(const bool _Idle_period, const uint64_t _Now, const uint64_t _Start) noexcept;
+
+    // Note: The counters are monotonic and read independently. The times are updated together,
+    //       so they are guarded by _Sequence (odd while they are updated) and read consistently.
+    atomic<uint64_t> _Executed;
+    atomic<uint64_t> _Submitted;
+    atomic<uint64_t> _Steals;
+    atomic<uint64_t> _Parks;
+    atomic<uint64_t> _Unparks;
+    atomic<size_t> _High_water;
+    atomic<uint32_t> _Sequence;
+    atomic<bool> _Idle; // the current period is idle
+    atomic<uint64_t> _Since; // start of the current period (see _Precise_tick_count()), 0 if none
+    atomic<uint64_t> _Busy_time;
+    atomic<uint64_t> _Idle_time;
 };
 
 // STRUCT _Thread_cache
@@ -77,8 +179,229 @@ struct _Thread_cache { // thread's internal cache
     _Thread_cache(const _Thread_cache&) = delete;
     _Thread_cache& operator=(const _Thread_cache&) = delete;
 
+    // tries to change the state, wakes the thread if succeeded
+    bool _Transition(thread_state _Old_state, const thread_state _New_state) noexcept;
+
+    // changes the state unconditionally, wakes the thread
+    void _Force_transition(const thread_state _New_state) noexcept;
+
+    // wakes the thread if it is blocked in _Wait_while()
+    void _Notify() noexcept;
+
+    // spins, then blocks until the state differs from _Old_state
+    void _Wait_while(const thread_state _Old_state) noexcept;
+
+    // returns the approximate number of pending tasks (doesn't lock)
+    size_t _Approximate_load() const noexcept;
+
+    // binds the calling thread as requested by _Affinity (called by the thread itself)
+    void _Bind() noexcept;
+
     atomic<thread_state> _State;
-    shared_queue<_Thread_task> _Queue;
+    atomic<uint32_t> _Epoch; // incremented on every state change (eventcount)
+    atomic<uint32_t> _Parked; // non-zero if the thread is blocked on _Epoch
+    atomic<uint32_t> _Spin_count;
+    atomic<uint32_t> _Cancel_epoch; // incremented when pending tasks are cancelled
+    atomic<size_t> _Buffered; // tasks taken from _Queue, but not performed yet
+    atomic<uint64_t> _Idle_since; // tick at which the thread started waiting, 0 if it's not waiting
+    atomic<_Thread_group*> _Group; // threads to steal from (optional)
+    thread* _Owner; // the thread that owns the cache, set while in a group
+    size_t _Slot; // index in the group, guarded by the group's lock
+    uint32_t _Seed; // selects the first victim, used only by the thread itself
+    uint32_t _Binding; // processor or node the thread is bound to, see _Affinity
+    uint32_t _Node; // NUMA node of the thread, 0 if not bound
+    thread_affinity _Affinity;
+
+    // Note: The queue (mailbox) is written by other threads, the deque (tasks scheduled by the thread
+    //       itself) mostly by the thread, so each of them starts on its own cache line. The counters
+    //       are written by the thread on every task, so they don't share a line with anything else.
+    alignas(_Cache_line_size) _Mpsc_priority_queue<_Thread_task, _Task_priority_levels> _Queue;
+    alignas(_Cache_line_size) _Work_stealing_deque<_Thread_task> _Deque;
+    _Thread_counters _Counters;
+};
+
+// FUNCTION _Current_thread_cache
+_NODISCARD_ATTR extern _Thread_cache* _Current_thread_cache() noexcept;
+
+// STRUCT _Injection_chunk
+struct _Injection_chunk {
+    static constexpr size_t _Capacity = 64;
+
+    _Injection_chunk* _Next; // pointer to the next chunk
+    size_t _Begin; // index of the first task
+    size_t _End; // index past the last task
+    _Thread_task _Tasks[_Capacity];
+};
+
+// CLASS _Injection_queue
+class _Injection_queue { // FIFO queue shared by all threads of the thread-pool
+public:
+    _Injection_queue() noexcept;
+    ~_Injection_queue() noexcept;
+
+    _Injection_queue(const _Injection_queue&) = delete;
+    _Injection_queue& operator=(const _Injection_queue&) = delete;
+
+    // checks if the queue is empty (doesn't lock)
+    bool _Empty() const noexcept;
+
+    // returns the number of tasks (doesn't lock)
+    size_t _Size() const noexcept;
+
+    // removes all tasks, returns the number of removed tasks
+    size_t _Clear() noexcept;
+
+    // tries to append a new task
+    _NODISCARD_ATTR bool _Push(const _Thread_task& _Task) noexcept;
+
+    // tries to append all tasks from the batch, returns the number of appended tasks
+    size_t _Push_many(const _Task_batch& _Batch) noexcept;
+
+    // removes up to _Count tasks, returns the number of removed tasks
+    size_t _Pop(_Thread_task* const _Tasks, const size_t _Count) noexcept;
+
+private:
+    using _Alloc = allocator<void>;
+
+    // tries to append a new (empty) chunk, the lock must be held
+    _NODISCARD_ATTR bool _Append_chunk() noexcept;
+
+    // Note: Tasks are stored in chunks, so a push allocates memory only once per
+    //       _Injection_chunk::_Capacity tasks. One empty chunk is kept for reuse.
+    _Injection_chunk* _Myfirst;
+    _Injection_chunk* _Mylast;
+    _Injection_chunk* _Myspare;
+    atomic<size_t> _Mysize;
+    shared_lock _Mylock;
+};
+
+// STRUCT _Member_table
+struct _Member_table { // members of a group, replaced (never shrunk) when the group grows
+    _Member_table* _Retired; // the replaced table, kept until the group is destroyed
+    size_t _Capacity; // multiple of 32
+    atomic<_Thread_cache*>* _Members;
+    atomic<uint32_t>* _Idle; // one bit per member
+};
+
+// CLASS _Thread_group
+class _Thread_group { // threads that steal tasks from each other
+public:
+    _Thread_group() noexcept;
+    ~_Thread_group() noexcept;
+
+    _Thread_group(const _Thread_group&) = delete;
+    _Thread_group& operator=(const _Thread_group&) = delete;
+
+    // tries to add a new thread to the group
+    _NODISCARD_ATTR bool _Add(thread& _Thread) noexcept;
+
+    // removes the thread from the group
+    void _Remove(thread& _Thread) noexcept;
+
+    // makes the thread unselectable, it still counts its tasks until it's removed
+    void _Withdraw(thread& _Thread) noexcept;
+
+    // marks the thread as idle (waiting) or busy
+    void _Set_idle(_Thread_cache& _Cache, const bool _Idle) noexcept;
+
+    // makes the group prefer threads on the caller's NUMA node (must be called before any thread is added)
+    void _Enable_numa_placement() noexcept;
+
+    // returns any idle thread (on the caller's NUMA node if possible) or null
+    thread* _Select_idle_thread() noexcept;
+
+    // returns the less loaded of two randomly chosen threads or null
+    thread* _Select_less_loaded_thread() noexcept;
+
+    // returns the least loaded thread or null
+    thread* _Select_least_loaded_thread() noexcept;
+
+    // returns the thread at _Hint modulo the number of threads or null
+    thread* _Select_thread_at(const size_t _Hint) noexcept;
+
+    // tries to schedule a new task in the injection queue, wakes one waiting thread
+    _NODISCARD_ATTR bool _Inject(const _Thread_task& _Task) noexcept;
+
+    // tries to schedule the batch in the injection queue, wakes one waiting thread per task
+    size_t _Inject_many(const _Task_batch& _Batch) noexcept;
+
+    // tries to move a batch of injected tasks to the thread's deque, returns one of them
+    _NODISCARD_ATTR bool _Refill(_Thread_cache& _Cache, _Thread_task& _Task) noexcept;
+
+    // returns the number of injected tasks
+    size_t _Injected_tasks() const noexcept;
+
+    // returns the number of tasks that have been scheduled, but haven't finished yet
+    size_t _Outstanding_tasks() const noexcept;
+
+    // returns the number of tasks performed by the threads, including the removed ones
+    uint64_t _Completed_tasks() noexcept;
+
+    // sums the counters of all threads, including the removed ones (doesn't block the threads)
+    thread_counters _Snapshot() noexcept;
+
+    // copies the counters of up to _Count threads, returns the number of threads
+    size_t _Snapshot_threads(thread_counters* const _Counters, const size_t _Count) noexcept;
+
+    // cancels all injected tasks
+    void _Cancel_injected_tasks() noexcept;
+
+    // counts _Count new tasks as outstanding, must be called before they are scheduled
+    void _Begin_tasks(const size_t _Count) noexcept;
+
+    // counts _Count tasks as finished (or cancelled), wakes the waiters if none is outstanding
+    void _Finish_tasks(const size_t _Count) noexcept;
+
+    // blocks until no task is outstanding, returns false if the time is out
+    bool _Wait_idle(const bool _Timed, const uint32_t _Milliseconds) noexcept;
+
+    // tries to steal half of some thread's tasks, returns one of them
+    _NODISCARD_ATTR bool _Steal(_Thread_cache& _Thief, _Thread_task& _Task) noexcept;
+
+    // checks if there are injected tasks or any other thread has tasks that can be stolen
+    bool _Has_stealable_tasks(const _Thread_cache& _Thief) noexcept;
+
+    // wakes one waiting thread, so it can steal tasks
+    void _Wake_one(const _Thread_cache* const _Except) noexcept;
+
+    // wakes up to _Count waiting threads
+    void _Wake(const size_t _Count, const _Thread_cache* const _Except) noexcept;
+
+private:
+    using _Alloc = allocator<void>;
+
+    static constexpr size_t _Max_refill = 32; // max number of tasks moved by _Refill()
+    static constexpr size_t _No_slot    = static_cast<size_t>(-1); // _Thread_cache::_Slot of withdrawn threads
+
+    // replaces the member with the last one, moves its idle bit as well
+    void _Erase_member(_Thread_cache& _Cache) noexcept;
+
+    // returns the member at the specified index, the lock must be held
+    _Thread_cache* _Member_at(const size_t _Idx) const noexcept;
+
+    // wakes up to _Count threads whose idle bits are set, doesn't lock
+    void _Wake_idle(size_t _Count, const _Thread_cache* const _Except, const uint32_t _Node) noexcept;
+
+    // returns the NUMA node whose threads should be preferred (the node of _Cache or of the caller)
+    uint32_t _Preferred_node(const _Thread_cache* const _Cache) const noexcept;
+
+    // Note: The idle bit N is set while the member N waits, so an idle thread is found without
+    //       touching other threads. The bits are only hints, the state is checked again.
+    //       The table is modified under the lock, but it's also read without it by the waking threads,
+    //       so it's published atomically and the replaced tables are kept until the group is destroyed.
+    atomic<_Member_table*> _Mytable;
+    size_t _Mysize;
+    shared_lock _Mylock;
+    _Injection_queue _Myinjected;
+    bool _Mynuma_aware; // threads on the same NUMA node are preferred
+    thread_counters _Myretired; // counters of the removed threads
+
+    // Note: Every scheduled task is counted until it is performed or cancelled.
+    //       _Myquiescence is the address waited on by wait_idle(). Its lowest bit is set if some
+    //       thread waits, the other bits change every time the last outstanding task finishes.
+    alignas(_Cache_line_size) atomic<size_t> _Myoutstanding;
+    atomic<uint32_t> _Myquiescence;
+    atomic<uint64_t> _Mysubmitted; // tasks scheduled by other threads than the group's members
 };
 
 // CLASS thread
@@ -105,6 +428,9 @@ public:
 
     explicit thread(const task _Task, void* const _Data) noexcept;
 
+    // creates a thread bound to the processor or NUMA node (used by the thread-pool)
+    explicit thread(const thread_affinity _Affinity, const uint32_t _Binding) noexcept;
+
     thread& operator=(thread&& _Other) noexcept;
 
     // returns the max number of threads
@@ -120,6 +446,10 @@ public:
     // returns thread's ID
     const id get_id() const noexcept;
 
+    // returns the calling thread's ID (e.g. for thread_pool::is_thread_in_pool()),
+    // on POSIX systems it's 0 unless the calling thread was created by this class
+    static id current_id() noexcept;
+
     // returns thread's native handle
     const native_handle_type native_handle() const noexcept;
 
@@ -129,6 +459,12 @@ public:
     // returns the number of pending tasks
     size_t pending_tasks() const noexcept;
 
+    // returns the number of spins before the waiting thread blocks
+    size_t spin_count() const noexcept;
+
+    // changes the number of spins before the waiting thread blocks
+    void set_spin_count(const size_t _Count) noexcept;
+
     // cancels all pending tasks
     void cancel_all_pending_tasks() noexcept;
 
@@ -148,6 +484,21 @@ public:
     // tries to resume the thread
     _NODISCARD_ATTR bool resume() noexcept;
 
+    // tries to schedule a new task (used by the thread-pool)
+    _NODISCARD_ATTR bool _Schedule_task(const _Thread_task& _Task) noexcept;
+
+    // tries to schedule the batch, returns the number of scheduled tasks (used by the thread-pool)
+    size_t _Schedule_tasks(const _Task_batch& _Batch) noexcept;
+
+    // returns the internal cache (used by the thread-pool)
+    _Thread_cache& _Get_cache() noexcept;
+
+    // tries to terminate the waiting thread if it has no pending tasks (used by the thread-pool)
+    _NODISCARD_ATTR bool _Retire() noexcept;
+
+    // waits until the retired thread exits and releases it (used by the thread-pool)
+    void _Join_retired() noexcept;
+
 private:
     // manages pending tasks
     static unsigned long __stdcall _Schedule_handler(void* const _Data) noexcept;
@@ -167,11 +518,6 @@ private:
     // prepares thread termination
     void _Tidy() noexcept;
 
-    struct _Has_higher_priority {
-        // checks if the task has higher priority
-        bool operator()(const _Thread_task& _Left, const _Thread_task& _Right) const noexcept;
-    };
-
     struct _Event_callback {
         event _Event;
         event_callback _Func;
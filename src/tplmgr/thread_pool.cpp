@@ -8,20 +8,24 @@
 #if _TPLMGR_PREPROCESSOR_GUARD
 
 _TPLMGR_BEGIN
-// FUNCTION _Thread_list_node constructor/destructor
-_Thread_list_node::_Thread_list_node() noexcept : _Next(nullptr), _Prev(nullptr), _Thread() {}
-
-_Thread_list_node::~_Thread_list_node() noexcept {}
-
-// FUNCTION _Thread_list_storage constructor/destructor
-_Thread_list_storage::_Thread_list_storage() noexcept : _Head(nullptr), _Tail(nullptr), _Size(0) {}
+// FUNCTION _Thread_list constructors/destructor
+_Thread_list::_Thread_list() noexcept
+    : _Mylock(), _Mychunks(nullptr), _Mychunk_count(0), _Myslots(nullptr), _Mysize(0), _Mygroup(),
+    _Myaffinity(thread_affinity::none) {}
 
-_Thread_list_storage::~_Thread_list_storage() noexcept {}
+_Thread_list::_Thread_list(const size_t _Size) noexcept
+    : _Mylock(), _Mychunks(nullptr), _Mychunk_count(0), _Myslots(nullptr), _Mysize(0), _Mygroup(),
+    _Myaffinity(thread_affinity::none) {
+    (void) _Grow(_Size);
+}
 
-// FUNCTION _Thread_list constructors/destructor
-_Thread_list::_Thread_list() noexcept : _Mypair(_Ebco_default_init{}) {}
+_Thread_list::_Thread_list(const size_t _Size, const thread_affinity _Affinity) noexcept
+    : _Mylock(), _Mychunks(nullptr), _Mychunk_count(0), _Myslots(nullptr), _Mysize(0), _Mygroup(),
+    _Myaffinity(_Affinity) {
+    if (_Affinity != thread_affinity::none) { // threads know their nodes
+        _Mygroup._Enable_numa_placement();
+    }
 
-_Thread_list::_Thread_list(const size_t _Size) noexcept : _Mypair(_Ebco_default_init{}) {
     (void) _Grow(_Size);
 }
 
@@ -29,86 +33,161 @@ _Thread_list::~_Thread_list() noexcept {
     _Release();
 }
 
-// FUNCTION _Thread_list::_Allocate_node
-_NODISCARD_ATTR bool _Thread_list::_Allocate_node(_Thread_list_node** const _Node, _Alloc& _Al) noexcept {
-    void* const _Raw = _Al.allocate(sizeof(_Thread_list_node));
-    if (!_Raw) { // allocation failed
+// FUNCTION _Thread_list::_Allocate_chunk
+_NODISCARD_ATTR bool _Thread_list::_Allocate_chunk() noexcept {
+    _Alloc _Al;
+    const size_t _Old_capacity = _Mychunk_count * _Chunk_size;
+    const size_t _New_capacity = _Old_capacity + _Chunk_size;
+    void* const _Raw_chunks    = _Al.allocate((_Mychunk_count + 1) * sizeof(_Thread_record*));
+    if (!_Raw_chunks) { // allocation failed
+        return false;
+    }
+
+    void* const _Raw_slots = _Al.allocate(_New_capacity * sizeof(uint32_t));
+    if (!_Raw_slots) { // allocation failed
+        _Al.deallocate(_Raw_chunks, (_Mychunk_count + 1) * sizeof(_Thread_record*));
+        return false;
+    }
+
+    void* const _Raw_records = allocator_traits::allocate(
+        _Chunk_size * sizeof(_Thread_record), alignof(_Thread_record));
+    if (!_Raw_records) { // allocation failed
+        _Al.deallocate(_Raw_slots, _New_capacity * sizeof(uint32_t));
+        _Al.deallocate(_Raw_chunks, (_Mychunk_count + 1) * sizeof(_Thread_record*));
+        return false;
+    }
+
+    _Thread_record** const _New_chunks = static_cast<_Thread_record**>(_Raw_chunks);
+    uint32_t* const _New_slots         = static_cast<uint32_t*>(_Raw_slots);
+    for (size_t _Idx = 0; _Idx < _Mychunk_count; ++_Idx) {
+        _New_chunks[_Idx] = _Mychunks[_Idx];
+    }
+
+    for (size_t _Idx = 0; _Idx < _Old_capacity; ++_Idx) {
+        _New_slots[_Idx] = _Myslots[_Idx];
+    }
+
+    for (size_t _Idx = _Old_capacity; _Idx < _New_capacity; ++_Idx) { // new slots are free
+        _New_slots[_Idx] = static_cast<uint32_t>(_Idx);
+    }
+
+    _New_chunks[_Mychunk_count] = static_cast<_Thread_record*>(_Raw_records);
+    if (_Mychunks) {
+        _Al.deallocate(_Mychunks, _Mychunk_count * sizeof(_Thread_record*));
+        _Al.deallocate(_Myslots, _Old_capacity * sizeof(uint32_t));
+    }
+
+    _Mychunks = _New_chunks;
+    _Myslots  = _New_slots;
+    ++_Mychunk_count;
+    return true;
+}
+
+// FUNCTION _Thread_list::_Next_binding
+uint32_t _Thread_list::_Next_binding() noexcept {
+    // Note: Processors are ordered so that consecutive ones belong to different nodes (see
+    //       _Cpu_topology::_Spread_cpu()), so threads are spread evenly across the nodes.
+    //       Dismissed threads leave gaps, which are filled first.
+    if (_Myaffinity == thread_affinity::none) { // not bound
+        return 0;
+    }
+
+    const _Cpu_topology& _Topology = _Cpu_topology::_Get();
+    const bool _Per_cpu            = _Myaffinity == thread_affinity::cpu;
+    const uint32_t _Count          = _Per_cpu ? _Topology._Cpu_count() : _Topology._Node_count();
+    uint32_t _Best                 = 0;
+    size_t _Best_users             = static_cast<size_t>(-1);
+    for (uint32_t _Idx = 0; _Idx < _Count && _Best_users > 0; ++_Idx) {
+        const uint32_t _Binding = _Per_cpu ? _Topology._Spread_cpu(_Idx) : _Idx;
+        size_t _Users           = 0;
+        for (size_t _Thread = 0; _Thread < _Mysize; ++_Thread) {
+            if (_At(_Thread)._Get_cache()._Binding == _Binding) {
+                ++_Users;
+            }
+        }
+
+        if (_Users < _Best_users) {
+            _Best       = _Binding;
+            _Best_users = _Users;
+        }
+    }
+
+    return _Best;
+}
+
+// FUNCTION _Thread_list::_Construct_thread
+_NODISCARD_ATTR bool _Thread_list::_Construct_thread() noexcept {
+    lock_guard _Guard(_Mylock);
+    if (_Mysize == _Mychunk_count * _Chunk_size) { // no free record, allocate a new chunk
+        if (!_Allocate_chunk()) {
+            return false;
+        }
+    }
+
+    const uint32_t _Slot          = _Myslots[_Mysize];
+    _Thread_record* const _Record = ::new (static_cast<void*>(
+        _Mychunks[_Slot / _Chunk_size] + _Slot % _Chunk_size)) _Thread_record(_Myaffinity, _Next_binding());
+    if (!_Mygroup._Add(_Record->_Thread)) { // not stealable, discard it
+        _Record->~_Thread_record();
         return false;
     }
 
-    *_Node = ::new (_Raw) _Thread_list_node;
+    ++_Mysize;
     return true;
 }
 
-// FUNCTION _Thread_list::_Free_node
-void _Thread_list::_Free_node(_Thread_list_node* _Node) noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    _Alloc& _Al                    = _Mypair._Get_val2();
-    if (_Node == _Storage._Head) { // free the first node
-        if (_Node->_Next) {
-            _Node->_Next->_Prev = nullptr;
-            _Storage._Head      = _Node->_Next;
+// FUNCTION _Thread_list::_Destroy_thread
+void _Thread_list::_Destroy_thread(const size_t _Idx) noexcept {
+    // Note: The thread is withdrawn before it's terminated, so no producer can select a thread
+    //       that refuses new tasks. Its record is freed early, but it can't be reused meanwhile,
+    //       since threads are only constructed while the pool's lock is not held exclusively.
+    const uint32_t _Slot = _Myslots[_Idx];
+    thread& _Thread      = _At(_Idx);
+    {
+        lock_guard _Guard(_Mylock); // nobody can select it now
+        _Mygroup._Withdraw(_Thread); // nobody can steal from it or wake it now
+        for (size_t _Next = _Idx + 1; _Next < _Mysize; ++_Next) { // keep the order of other threads
+            _Myslots[_Next - 1] = _Myslots[_Next];
         }
-    } else if (_Node == _Storage._Tail) { // free the last node
-        _Node->_Prev->_Next = nullptr;
-        _Storage._Tail      = _Node->_Prev;
-    } else { // free the inner node
-        _Node->_Prev->_Next = _Node->_Next;
-        _Node->_Next->_Prev = _Node->_Prev;
+
+        _Myslots[--_Mysize] = _Slot;
     }
 
-    _Node->~_Thread_list_node();
-    _Al.deallocate(_Node, sizeof(_Thread_list_node));
-    --_Storage._Size;
+    (void) _Thread.terminate(); // discarded tasks are still counted by the group, see wait_idle()
+    _Thread.cancel_all_pending_tasks(); // tasks scheduled before it was withdrawn
+    _Mygroup._Remove(_Thread);
+    _Thread.~thread();
 }
 
 // FUNCTION _Thread_list::_Reduce_waiting_threads
 void _Thread_list::_Reduce_waiting_threads(size_t& _Count) noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    _Thread_list_node* _Node       = _Storage._Head;
-    _Thread_list_node* _Next;
-    while (_Node && _Count > 0) {
-        _Next = _Node->_Next;
-        if (_Node->_Thread.state() == thread_state::waiting) {
-            _Free_node(_Node);
+    size_t _Idx = 0;
+    while (_Idx < _Mysize && _Count > 0) {
+        if (_At(_Idx).state() == thread_state::waiting) {
+            _Destroy_thread(_Idx); // the next thread moves to _Idx
             --_Count;
+        } else {
+            ++_Idx;
         }
-
-        _Node = _Next;
     }
 }
 
 // FUNCTION _Thread_list::_Size
 const size_t _Thread_list::_Size() const noexcept {
-    return _Mypair._Val1._Size;
+    return _Mysize;
+}
+
+// FUNCTION _Thread_list::_Affinity
+thread_affinity _Thread_list::_Affinity() const noexcept {
+    return _Myaffinity;
 }
 
 // FUNCTION _Thread_list::_Grow
 _NODISCARD_ATTR bool _Thread_list::_Grow(size_t _Count) noexcept {
-    if (_Count == 0) { // no growth, do nothing
-        return true;
-    }
-
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    _Alloc& _Al                    = _Mypair._Get_val2();
-    if (_Storage._Size == 0) { // allocate the first node
-        if (!_Allocate_node(_TPLMGR addressof(_Storage._Head), _Al)) {
-            return false;
-        }
-
-        _Storage._Tail = _Storage._Head;
-        ++_Storage._Size;
-        --_Count; // one node is already allocated
-    }
-
     while (_Count-- > 0) {
-        if (!_Allocate_node(_TPLMGR addressof(_Storage._Tail->_Next), _Al)) {
+        if (!_Construct_thread()) {
             return false;
         }
-
-        _Storage._Tail->_Next->_Prev = _Storage._Tail;
-        _Storage._Tail               = _Storage._Tail->_Next;
-        ++_Storage._Size;
     }
 
     return true;
@@ -120,30 +199,18 @@ _NODISCARD_ATTR bool _Thread_list::_Reduce(size_t _Count) noexcept {
         return true;
     }
 
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    if (_Count > _Storage._Size) { // not enough threads
+    if (_Count > _Mysize) { // not enough threads
         return false;
     }
 
-    if (_Count == _Storage._Size) { // reduce to 0
+    if (_Count == _Mysize) { // reduce to 0
         _Release();
         return true;
     }
 
     _Reduce_waiting_threads(_Count);
-    if (_Count == 0) { // no need to reduce more threads
-        return true;
-    }
-
-    _Alloc& _Al     = _Mypair._Get_val2();
-    _Storage._Size -= _Count; // subtract once
-    _Thread_list_node* _Node;
-    while (_Count-- > 0) {
-        _Node               = _Storage._Tail;
-        _Node->_Prev->_Next = nullptr;
-        _Storage._Tail      = _Node->_Prev;
-        _Node->~_Thread_list_node();
-        _Al.deallocate(_Node, sizeof(_Thread_list_node));
+    while (_Count-- > 0) { // dismiss the last threads
+        _Destroy_thread(_Mysize - 1);
     }
 
     return true;
@@ -151,102 +218,131 @@ _NODISCARD_ATTR bool _Thread_list::_Reduce(size_t _Count) noexcept {
 
 // FUNCTION _Thread_list::_Release
 void _Thread_list::_Release() noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    _Alloc& _Al                    = _Mypair._Get_val2();
-    _Thread_list_node* _Next;
-    for (_Thread_list_node* _Node = _Storage._Head; _Node != nullptr; _Node = _Next) {
-        _Next = _Node->_Next;
-        _Node->~_Thread_list_node();
-        _Al.deallocate(_Node, sizeof(_Thread_list_node));
-    }
-
-    _Storage._Head = nullptr;
-    _Storage._Tail = nullptr;
-    _Storage._Size = 0;
-}
-
-// FUNCTION _Thread_list::_Select_thread
-thread* _Thread_list::_Select_thread(size_t _Which) noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    if (_Which >= _Storage._Size) { // not enough threads
-        return nullptr;
+    while (_Mysize > 0) {
+        _Destroy_thread(_Mysize - 1);
     }
 
-    if (_Which == 0) { // select the first thread
-        return _TPLMGR addressof(_Storage._Head->_Thread);
-    } else if (_Which == _Storage._Size - 1) { // select the last thread
-        return _TPLMGR addressof(_Storage._Tail->_Thread);
-    } else { // select the inner thread
-        _Thread_list_node* _Node = _Storage._Head;
-        while (_Which-- > 0) {
-            _Node = _Node->_Next;
+    lock_guard _Guard(_Mylock);
+    if (_Mychunks) {
+        _Alloc _Al;
+        for (size_t _Idx = 0; _Idx < _Mychunk_count; ++_Idx) {
+            allocator_traits::deallocate(
+                _Mychunks[_Idx], _Chunk_size * sizeof(_Thread_record), alignof(_Thread_record));
         }
 
-        return _TPLMGR addressof(_Node->_Thread);
+        _Al.deallocate(_Mychunks, _Mychunk_count * sizeof(_Thread_record*));
+        _Al.deallocate(_Myslots, _Mychunk_count * _Chunk_size * sizeof(uint32_t));
+        _Mychunks      = nullptr;
+        _Mychunk_count = 0;
+        _Myslots       = nullptr;
     }
 }
 
-// FUNCTION _Thread_list::_Select_thread_by_id
-thread* _Thread_list::_Select_thread_by_id(const thread::id _Id) noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    if (_Storage._Size == 0) {
-        return nullptr;
-    }
+// FUNCTION _Thread_list::_Dismiss_idle_threads
+size_t _Thread_list::_Dismiss_idle_threads(const size_t _Count, const uint64_t _Since) noexcept {
+    // Note: The last threads are dismissed first, so the remaining ones keep their order.
+    size_t _Dismissed = 0;
+    for (size_t _Idx = _Mysize; _Idx-- > 0 && _Dismissed < _Count;) {
+        thread& _Thread            = _At(_Idx);
+        const uint64_t _Idle_since = _Thread._Get_cache()._Idle_since.load(_STD memory_order_relaxed);
+        if (_Idle_since == 0 || _Idle_since > _Since) { // working or not idle long enough
+            continue;
+        }
 
-    _Thread_list_node* _Node = _Storage._Head;
-    while (_Node) {
-        if (_Node->_Thread.get_id() == _Id) {
-            return _TPLMGR addressof(_Node->_Thread);
+        {
+            lock_guard _Guard(_Mylock); // no task can be scheduled to it meanwhile
+            if (!_Thread._Retire()) { // resumed meanwhile or some task is pending
+                continue;
+            }
+
+            _Mygroup._Remove(_Thread); // nobody can select it now
         }
 
-        _Node = _Node->_Next;
+        _Thread._Join_retired();
+        _Destroy_thread(_Idx); // already terminated, only destroyed
+        ++_Dismissed;
     }
 
-    return nullptr;
+    return _Dismissed;
 }
 
-// FUNCTION _Thread_list::_Select_any_waiting_thread
-thread* _Thread_list::_Select_any_waiting_thread() noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    if (_Storage._Size == 0) {
-        return nullptr;
-    }
+// FUNCTION _Thread_list::_Select_thread
+thread* _Thread_list::_Select_thread(const size_t _Which) noexcept {
+    return _Which < _Mysize ? _TPLMGR addressof(_At(_Which)) : nullptr;
+}
 
-    _Thread_list_node* _Node = _Storage._Head;
-    while (_Node) {
-        if (_Node->_Thread.state() == thread_state::waiting) {
-            return _TPLMGR addressof(_Node->_Thread);
+// FUNCTION _Thread_list::_Select_thread_by_id
+thread* _Thread_list::_Select_thread_by_id(const thread::id _Id) noexcept {
+    for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+        thread& _Thread = _At(_Idx);
+        if (_Thread.get_id() == _Id) {
+            return _TPLMGR addressof(_Thread);
         }
-
-        _Node = _Node->_Next;
     }
 
     return nullptr;
 }
 
-// FUNCTION _Thread_list::_Select_thread_with_fewest_pending_tasks
-thread* _Thread_list::_Select_thread_with_fewest_pending_tasks() noexcept {
-    _Thread_list_storage& _Storage = _Mypair._Val1;
-    if (_Storage._Size == 0) {
-        return nullptr;
-    }
+// FUNCTION _Thread_list::_Group
+_Thread_group& _Thread_list::_Group() noexcept {
+    return _Mygroup;
+}
 
-    thread* _Result = _TPLMGR addressof(_Storage._Head->_Thread); // first thread by default
-    size_t _Count   = _Result->pending_tasks();
-    for (_Thread_list_node* _Node = _Storage._Head->_Next; _Node != nullptr; _Node = _Node->_Next) {
-        const size_t _Tasks = _Node->_Thread.pending_tasks();
-        if (_Tasks < _Count) {
-            _Result = _TPLMGR addressof(_Node->_Thread);
-            _Count  = _Tasks;
-        }
-    }
+// FUNCTION _Thread_list::_Lock
+shared_lock& _Thread_list::_Lock() const noexcept {
+    return _Mylock;
+}
 
-    return _Result;
+// FUNCTION _Producer_id
+static size_t _Producer_id() noexcept { // identifies the scheduling thread (sticky policy)
+    static atomic<size_t> _Next_id(0);
+    static thread_local const size_t _Id = _Next_id.fetch_add(1, _STD memory_order_relaxed);
+    return _Id;
 }
 
-// FUNCTION thread_pool copy constructor/destructor
-thread_pool::thread_pool(const size_t _Size) noexcept : _Mylist(
-    (_STD max)(_Size, size_t{1})), _Mystate(_Working) {} // at least 1 thread must be active
+// FUNCTION thread_pool constructors/destructor
+thread_pool::thread_pool(const size_t _Size) noexcept : _Mylist((_STD max)(_Size, size_t{1})),
+    _Mylock(), _Mystate(_Working), _Myspin(_Default_spin_count), _Mypolicy(scheduling_policy::idle_first),
+    _Mynext(0), _Myblocked(0), _Mycompensating(0), _Mycompensation_limit(thread::hardware_concurrency()),
+    _Myretiring(false), _Mytimers(*this), _Myscaler(*this) {} // at least 1 thread must be active
+
+thread_pool::thread_pool(const size_t _Size, const size_t _Spin_count) noexcept
+    : _Mylist((_STD max)(_Size, size_t{1})), _Mylock(), _Mystate(_Working), _Myspin(_Spin_count),
+    _Mypolicy(scheduling_policy::idle_first), _Mynext(0), _Myblocked(0), _Mycompensating(0),
+    _Mycompensation_limit(thread::hardware_concurrency()), _Myretiring(false), _Mytimers(*this),
+    _Myscaler(*this) {
+    _Apply_spin_count();
+}
+
+thread_pool::thread_pool(const size_t _Size, const scheduling_policy _Policy) noexcept
+    : _Mylist((_STD max)(_Size, size_t{1})), _Mylock(), _Mystate(_Working), _Myspin(_Default_spin_count),
+    _Mypolicy(_Policy), _Mynext(0), _Myblocked(0), _Mycompensating(0),
+    _Mycompensation_limit(thread::hardware_concurrency()), _Myretiring(false), _Mytimers(*this),
+    _Myscaler(*this) {}
+
+thread_pool::thread_pool(
+    const size_t _Size, const size_t _Spin_count, const scheduling_policy _Policy) noexcept
+    : _Mylist((_STD max)(_Size, size_t{1})), _Mylock(), _Mystate(_Working), _Myspin(_Spin_count),
+    _Mypolicy(_Policy), _Mynext(0), _Myblocked(0), _Mycompensating(0),
+    _Mycompensation_limit(thread::hardware_concurrency()), _Myretiring(false), _Mytimers(*this),
+    _Myscaler(*this) {
+    _Apply_spin_count();
+}
+
+thread_pool::thread_pool(const size_t _Size, const thread_affinity _Affinity) noexcept
+    : _Mylist((_STD max)(_Size, size_t{1}), _Affinity), _Mylock(), _Mystate(_Working),
+    _Myspin(_Default_spin_count), _Mypolicy(scheduling_policy::idle_first), _Mynext(0), _Myblocked(0),
+    _Mycompensating(0), _Mycompensation_limit(thread::hardware_concurrency()), _Myretiring(false),
+    _Mytimers(*this), _Myscaler(*this) {}
+
+thread_pool::thread_pool(const size_t _Size, const size_t _Spin_count,
+    const scheduling_policy _Policy, const thread_affinity _Affinity) noexcept
+    : _Mylist((_STD max)(_Size, size_t{1}), _Affinity), _Mylock(), _Mystate(_Working),
+    _Myspin(_Spin_count), _Mypolicy(_Policy), _Mynext(0), _Myblocked(0), _Mycompensating(0),
+    _Mycompensation_limit(thread::hardware_concurrency()), _Myretiring(false), _Mytimers(*this),
+    _Myscaler(*this) {
+    _Apply_spin_count();
+}
 
 thread_pool::~thread_pool() noexcept {
     close();
@@ -254,16 +350,28 @@ thread_pool::~thread_pool() noexcept {
 
 // FUNCTION thread_pool::_Select_ideal_thread
 thread* thread_pool::_Select_ideal_thread() noexcept {
-    switch (_Mystate) {
+    switch (_Load_state()) {
     case _Waiting: // all threads are waiting, choose the one with the fewest pending tasks
-        return _Mylist._Select_thread_with_fewest_pending_tasks();
-    case _Working: // some threads may be waiting, choose one if available
+        return _Mylist._Group()._Select_least_loaded_thread();
+    case _Working: // select the thread according to the policy
     {
-        thread* _Thread = _Mylist._Select_any_waiting_thread();
-        if (_Thread) { // some thread is waiting, select it
-            return _Thread;
-        } else { // no thread is waiting, choose the thread with the fewest pending tasks
-            return _Mylist._Select_thread_with_fewest_pending_tasks();
+        // Note: All selections except least_loaded are O(1) and none of them locks other threads'
+        //       queues, so the cost of scheduling doesn't grow with the number of threads.
+        _Thread_group& _Group = _Mylist._Group();
+        switch (_Mypolicy.load(_STD memory_order_relaxed)) {
+        case scheduling_policy::round_robin:
+            return _Group._Select_thread_at(_Mynext.fetch_add(1, _STD memory_order_relaxed));
+        case scheduling_policy::power_of_two_choices:
+            return _Group._Select_less_loaded_thread();
+        case scheduling_policy::least_loaded:
+            return _Group._Select_least_loaded_thread();
+        case scheduling_policy::sticky:
+            return _Group._Select_thread_at(_Producer_id());
+        default: // some thread may be waiting, choose one if available
+        {
+            thread* const _Thread = _Group._Select_idle_thread();
+            return _Thread ? _Thread : _Group._Select_less_loaded_thread();
+        }
         }
     }
     default:
@@ -274,39 +382,177 @@ thread* thread_pool::_Select_ideal_thread() noexcept {
     }
 }
 
+// FUNCTION thread_pool::_Schedule_local_task
+bool thread_pool::_Schedule_local_task(const _Thread_task& _Task) noexcept {
+    // Note: Tasks scheduled by the pool's own threads (e.g. recursive tasks) are pushed to
+    //       the scheduling thread's deque. The thread pops them in LIFO order (the data is likely
+    //       still in its cache), while other threads may steal the oldest ones.
+    _Thread_cache* const _Cache = _Current_thread_cache();
+    _Thread_group& _Group       = _Mylist._Group();
+    if (!_Cache || _Cache->_Group.load(_STD memory_order_relaxed) != _TPLMGR addressof(_Group)) {
+        return false; // not a thread of this pool
+    }
+
+    if (!_Cache->_Deque._Push(_Task)) {
+        return false;
+    }
+
+    _Cache->_Counters._Observe(_Cache->_Deque._Size());
+    _Group._Wake_one(_Cache); // let some waiting thread steal the task
+    return true;
+}
+
+// FUNCTION thread_pool::_Schedule_local_tasks
+bool thread_pool::_Schedule_local_tasks(const _Task_batch& _Batch) noexcept {
+    _Thread_cache* const _Cache = _Current_thread_cache();
+    _Thread_group& _Group       = _Mylist._Group();
+    if (!_Cache || _Cache->_Group.load(_STD memory_order_relaxed) != _TPLMGR addressof(_Group)) {
+        return false; // not a thread of this pool
+    }
+
+    if (!_Cache->_Deque._Reserve(_Batch._Count)) { // no space for the whole batch
+        return false;
+    }
+
+    for (size_t _Idx = 0; _Idx < _Batch._Count; ++_Idx) {
+        (void) _Cache->_Deque._Push(_Batch[_Idx]); // cannot fail, the space is reserved
+    }
+
+    _Cache->_Counters._Observe(_Cache->_Deque._Size());
+    _Group._Wake(_Batch._Count, _Cache); // let some waiting threads steal the tasks
+    return true;
+}
+
+// FUNCTION thread_pool::_Schedule_batch
+size_t thread_pool::_Schedule_batch(const _Task_batch& _Batch) noexcept {
+    if (_Load_state() == _Closed || _Batch._Count == 0) { // scheduling inactive or nothing to do
+        return 0;
+    }
+
+    // Note: Tasks with normal priority are scheduled the same way as by schedule_task(),
+    //       but under one lock. Always a prefix of the batch is scheduled, so the caller knows
+    //       which tasks have not been scheduled if some allocation fails.
+    _Thread_group& _Group = _Mylist._Group();
+    _Group._Begin_tasks(_Batch._Count); // must be counted before any thread can finish them
+    if (_Batch._Priority == task_priority::normal) {
+        if (_Schedule_local_tasks(_Batch)) { // scheduled by the pool's own thread
+            return _Batch._Count;
+        }
+
+        if (_Mypolicy.load(_STD memory_order_relaxed) == scheduling_policy::idle_first) { // see _Push_task()
+            const size_t _Injected = _Group._Inject_many(_Batch);
+            _Group._Finish_tasks(_Batch._Count - _Injected); // not scheduled
+            return _Injected;
+        }
+    }
+
+    // Note: Other tasks are split into contiguous slices, one per thread, so each thread's queue
+    //       is locked once and each thread is resumed at most once.
+    shared_lock_guard _Guard(_Mylist._Lock());
+    if (_Mylist._Size() == 0) { // no thread has been created or the pool has been closed meanwhile
+        _Group._Finish_tasks(_Batch._Count); // not scheduled
+        return 0;
+    }
+
+    const size_t _Slice = (_Batch._Count + _Mylist._Size() - 1) / _Mylist._Size();
+    size_t _Scheduled   = 0;
+    _Mylist._For_each_thread(
+        [&_Batch, _Slice, &_Scheduled](thread& _Thread) noexcept {
+            const size_t _Count = (_STD min)(_Slice, _Batch._Count - _Scheduled);
+            if (_Count > 0) {
+                _Scheduled += _Thread._Schedule_tasks(_Batch._Slice(_Scheduled, _Count));
+            }
+        }
+    );
+
+    if (_Scheduled < _Batch._Count) { // some threads refused their slices, try the remaining ones
+        thread* const _Thread = _Select_ideal_thread();
+        if (_Thread) {
+            _Scheduled += _Thread->_Schedule_tasks(
+                _Batch._Slice(_Scheduled, _Batch._Count - _Scheduled));
+        }
+    }
+
+    _Group._Finish_tasks(_Batch._Count - _Scheduled); // not scheduled
+    return _Scheduled;
+}
+
+// FUNCTION thread_pool::_Apply_spin_count
+void thread_pool::_Apply_spin_count() noexcept {
+    const size_t _Count = _Myspin;
+    _Mylist._For_each_thread(
+        [_Count](thread& _Thread) noexcept {
+            _Thread.set_spin_count(_Count);
+        }
+    );
+}
+
 // FUNCTION thread_pool::threads
 size_t thread_pool::threads() const noexcept {
+    shared_lock_guard _Guard(_Mylist._Lock());
     return _Mylist._Size();
 }
 
+// FUNCTION thread_pool::spin_count
+size_t thread_pool::spin_count() const noexcept {
+    return _Myspin;
+}
+
+// FUNCTION thread_pool::set_spin_count
+void thread_pool::set_spin_count(const size_t _Count) noexcept {
+    shared_lock_guard _Guard(_Mylist._Lock());
+    _Myspin = _Count;
+    _Apply_spin_count();
+}
+
+// FUNCTION thread_pool::policy
+scheduling_policy thread_pool::policy() const noexcept {
+    return _Mypolicy.load(_STD memory_order_relaxed);
+}
+
+// FUNCTION thread_pool::set_policy
+void thread_pool::set_policy(const scheduling_policy _Policy) noexcept {
+    _Mypolicy.store(_Policy, _STD memory_order_relaxed);
+}
+
+// FUNCTION thread_pool::affinity
+thread_affinity thread_pool::affinity() const noexcept {
+    return _Mylist._Affinity();
+}
+
 // FUNCTION thread_pool::is_open
 bool thread_pool::is_open() const noexcept {
-    return _Mystate != _Closed;
+    return _Load_state() != _Closed;
 }
 
 // FUNCTION thread_pool::is_waiting
 bool thread_pool::is_waiting() const noexcept {
-    return _Mystate == _Waiting;
+    return _Load_state() == _Waiting;
 }
 
 // FUNCTION thread_pool::is_working
 bool thread_pool::is_working() const noexcept {
-    return _Mystate == _Working;
+    return _Load_state() == _Working;
 }
 
 // FUNCTION thread_pool::close
 void thread_pool::close() noexcept {
-    _Mystate = _Closed;
+    _Myscaler._Stop(); // must not wait for the lock
+    _Mytimers._Stop(); // pending timers are discarded
+    lock_guard _Guard(_Mylock);
+    _Mystate.store(_Closed, _STD memory_order_release);
     _Mylist._Release();
+    _Mylist._Group()._Cancel_injected_tasks(); // wakes threads blocked in wait_idle()
 }
 
 // FUNCTION thread_pool::collect_statistics
 _NODISCARD_ATTR thread_pool::statistics thread_pool::collect_statistics() noexcept {
-    if (_Mystate == _Closed) { // must not be closed
+    if (_Load_state() == _Closed) { // must not be closed
         return statistics{0, 0, 0};
     }
 
-    statistics _Result = {0, 0, 0};
+    shared_lock_guard _Guard(_Mylist._Lock());
+    statistics _Result = {0, 0, _Mylist._Group()._Injected_tasks()};
     _Mylist._For_each_thread(
         [&_Result](thread& _Thread) mutable noexcept {
             _Result.pending_tasks += _Thread.pending_tasks();
@@ -321,23 +567,44 @@ _NODISCARD_ATTR thread_pool::statistics thread_pool::collect_statistics() noexce
     return _Result;
 }
 
+// FUNCTION thread_pool::snapshot
+_NODISCARD_ATTR thread_counters thread_pool::snapshot() noexcept {
+    return _Mylist._Group()._Snapshot();
+}
+
+size_t thread_pool::snapshot(thread_counters* const _Counters, const size_t _Count) noexcept {
+    return _Mylist._Group()._Snapshot_threads(_Counters, _Count);
+}
+
 // FUNCTION thread_pool::is_thread_in_pool
 bool thread_pool::is_thread_in_pool(const thread::id _Id) const noexcept {
+    shared_lock_guard _Guard(_Mylist._Lock());
     return _Mylist._Select_thread_by_id(_Id) != nullptr;
 }
 
-// FUNCTION thread_pool::increase_threads
-_NODISCARD_ATTR bool thread_pool::increase_threads(const size_t _Count) noexcept {
-    if (_Mystate == _Closed) { // must not be closed
+// FUNCTION thread_pool::_Increase_threads
+bool thread_pool::_Increase_threads(const size_t _Count) noexcept {
+    if (_Load_state() == _Closed) { // must not be closed
         return false;
     }
 
-    return _Mylist._Grow(_Count);
+    const bool _Result = _Mylist._Grow(_Count);
+    if (_Myspin != _Default_spin_count) { // new threads use the default spin count
+        shared_lock_guard _Guard(_Mylist._Lock());
+        _Apply_spin_count();
+    }
+
+    _Thread_group& _Group = _Mylist._Group();
+    if (_Load_state() == _Working && _Group._Outstanding_tasks() > 0) { // new threads wait, let them help
+        _Group._Wake(_Count, nullptr);
+    }
+
+    return _Result;
 }
 
-// FUNCTION thread_pool::decrease_threads
-_NODISCARD_ATTR bool thread_pool::decrease_threads(const size_t _Count) noexcept {
-    if (_Mystate == _Closed) { // must not be closed
+// FUNCTION thread_pool::_Decrease_threads
+bool thread_pool::_Decrease_threads(const size_t _Count) noexcept {
+    if (_Load_state() == _Closed) { // must not be closed
         return false;
     }
     
@@ -348,9 +615,22 @@ _NODISCARD_ATTR bool thread_pool::decrease_threads(const size_t _Count) noexcept
     return _Mylist._Reduce(_Count);
 }
 
+// FUNCTION thread_pool::increase_threads
+_NODISCARD_ATTR bool thread_pool::increase_threads(const size_t _Count) noexcept {
+    lock_guard _Guard(_Mylock);
+    return _Increase_threads(_Count);
+}
+
+// FUNCTION thread_pool::decrease_threads
+_NODISCARD_ATTR bool thread_pool::decrease_threads(const size_t _Count) noexcept {
+    lock_guard _Guard(_Mylock);
+    return _Decrease_threads(_Count);
+}
+
 // FUNCTION thread_pool::resize
 _NODISCARD_ATTR bool thread_pool::resize(const size_t _New_size) noexcept {
-    if (_Mystate == _Closed) { // must not be closed
+    lock_guard _Guard(_Mylock);
+    if (_Load_state() == _Closed) { // must not be closed
         return false;
     }
     
@@ -364,15 +644,165 @@ _NODISCARD_ATTR bool thread_pool::resize(const size_t _New_size) noexcept {
     }
 
     if (_New_size > _Old_size) { // hire additional threads
-        return increase_threads(_New_size - _Old_size);
+        return _Increase_threads(_New_size - _Old_size);
     } else { // dismiss some of the existing threads
-        return decrease_threads(_Old_size - _New_size);
+        return _Decrease_threads(_Old_size - _New_size);
+    }
+}
+
+// FUNCTION thread_pool::enable_auto_scaling
+_NODISCARD_ATTR bool thread_pool::enable_auto_scaling(const scaling_options& _Options) noexcept {
+    if (_Load_state() == _Closed) { // must not be closed
+        return false;
+    }
+
+    if (_Options.min_threads == 0 || _Options.max_threads < _Options.min_threads
+        || _Options.interval == 0) { // at least 1 thread must be available
+        return false;
+    }
+
+    return _Myscaler._Start(_Options);
+}
+
+// FUNCTION thread_pool::disable_auto_scaling
+void thread_pool::disable_auto_scaling() noexcept {
+    _Myscaler._Stop();
+}
+
+// FUNCTION thread_pool::is_auto_scaling
+bool thread_pool::is_auto_scaling() const noexcept {
+    return _Myscaler._Running();
+}
+
+// FUNCTION thread_pool::_Sample
+_Scaling_sample thread_pool::_Sample() noexcept {
+    shared_lock_guard _Guard(_Mylist._Lock());
+    _Thread_group& _Group   = _Mylist._Group();
+    _Scaling_sample _Result = {_Mylist._Size(), 0, _Group._Outstanding_tasks(), _Group._Completed_tasks()};
+    _Mylist._For_each_thread(
+        [&_Result](thread& _Thread) noexcept {
+            if (_Thread.state() == thread_state::waiting) {
+                ++_Result._Idle_threads;
+            }
+        }
+    );
+
+    return _Result;
+}
+
+// FUNCTION thread_pool::_Dismiss_idle_threads
+size_t thread_pool::_Dismiss_idle_threads(const size_t _Count, const uint64_t _Since) noexcept {
+    lock_guard _Guard(_Mylock);
+    if (_Load_state() == _Closed || _Mylist._Size() <= 1) { // at least 1 thread must be available
+        return 0;
+    }
+
+    return _Mylist._Dismiss_idle_threads((_STD min)(_Count, _Mylist._Size() - 1), _Since);
+}
+
+// FUNCTION thread_pool::enter_blocking
+_NODISCARD_ATTR bool thread_pool::enter_blocking() noexcept {
+    if (_Load_state() == _Closed) { // must not be closed
+        return false;
+    }
+
+    _Thread_cache* const _Cache = _Current_thread_cache();
+    _Thread_group& _Group       = _Mylist._Group();
+    if (!_Cache || _Cache->_Group.load(_STD memory_order_relaxed) != _TPLMGR addressof(_Group)) {
+        return false; // not a thread of this pool
+    }
+
+    // Note: One thread is hired per blocked task, up to the limit. Threads hired earlier and not
+    //       retired yet are reused, so a series of short blocking calls doesn't churn threads.
+    const size_t _Blocked = _Myblocked.fetch_add(1, _STD memory_order_relaxed) + 1;
+    const size_t _Wanted  = (_STD min)(_Blocked, _Mycompensation_limit.load(_STD memory_order_relaxed));
+    size_t _Hired         = _Mycompensating.load(_STD memory_order_relaxed);
+    do {
+        if (_Hired >= _Wanted) { // enough threads compensate already
+            return true;
+        }
+    } while (!_Mycompensating.compare_exchange_weak(_Hired, _Hired + 1, _STD memory_order_relaxed));
+
+    // Note: _Mylock is only tried, since its holder (e.g. close()) may be waiting for this task.
+    //       In that case the task simply blocks without compensation.
+    bool _Result = false;
+    if (_Mylock.try_lock_shared()) {
+        _Result = _Increase_threads(1);
+        _Mylock.unlock_shared();
+    }
+
+    if (!_Result) { // not hired, forget it
+        _Mycompensating.fetch_sub(1, _STD memory_order_relaxed);
+    }
+
+    return true;
+}
+
+// FUNCTION thread_pool::leave_blocking
+void thread_pool::leave_blocking() noexcept {
+    const size_t _Blocked = _Myblocked.fetch_sub(1, _STD memory_order_relaxed) - 1;
+    if (_Mycompensating.load(_STD memory_order_relaxed) > _Blocked) { // some threads are surplus
+        _Schedule_retirement();
+    }
+}
+
+// FUNCTION thread_pool::compensation_limit
+size_t thread_pool::compensation_limit() const noexcept {
+    return _Mycompensation_limit.load(_STD memory_order_relaxed);
+}
+
+// FUNCTION thread_pool::set_compensation_limit
+void thread_pool::set_compensation_limit(const size_t _Limit) noexcept {
+    _Mycompensation_limit.store(_Limit, _STD memory_order_relaxed);
+}
+
+// FUNCTION thread_pool::_Schedule_retirement
+void thread_pool::_Schedule_retirement() noexcept {
+    // Note: Surplus threads are retired after _Compensation_delay, so they can still compensate
+    //       the next blocking call and finish the tasks that queued up while the others blocked.
+    bool _Expected = false;
+    if (!_Myretiring.compare_exchange_strong(_Expected, true, _STD memory_order_relaxed)) {
+        return; // already scheduled
+    }
+
+    if (_Load_state() == _Closed || _Mytimers._Add(_Tick_count() + _Compensation_delay, 0,
+        _Thread_task{&_Retire_handler, this, task_priority::normal}) == 0) { // nothing to retire later
+        _Myretiring.store(false, _STD memory_order_relaxed);
+    }
+}
+
+// FUNCTION thread_pool::_Retire_compensating_threads
+void thread_pool::_Retire_compensating_threads() noexcept {
+    _Myretiring.store(false, _STD memory_order_relaxed); // leave_blocking() may schedule it again
+    const size_t _Hired   = _Mycompensating.load(_STD memory_order_relaxed);
+    const size_t _Blocked = _Myblocked.load(_STD memory_order_relaxed);
+    if (_Hired <= _Blocked) { // all threads still compensate
+        return;
+    }
+
+    // Note: _Mylock is only tried, since its holder (e.g. decrease_threads()) may be waiting
+    //       for this task. The retirement is then postponed.
+    if (!_Mylock.try_lock()) {
+        _Schedule_retirement();
+        return;
+    }
+
+    const size_t _Surplus  = _Hired - _Blocked;
+    const size_t _Possible = _Load_state() == _Closed ? 0 : (_STD min)(_Surplus, _Mylist._Size() - 1);
+    _Mycompensating.fetch_sub(_Surplus - _Possible, _STD memory_order_relaxed); // dismissed already
+    const size_t _Dismissed = _Mylist._Dismiss_idle_threads(_Possible, _Tick_count());
+    _Mylock.unlock();
+    _Mycompensating.fetch_sub(_Dismissed, _STD memory_order_relaxed);
+    if (_Dismissed < _Possible) { // some threads are still working, try again later
+        _Schedule_retirement();
     }
 }
 
 // FUNCTION thread_pool::cancel_all_pending_tasks
 void thread_pool::cancel_all_pending_tasks() noexcept {
-    if (_Mystate != _Closed) { // must not be closed
+    if (_Load_state() != _Closed) { // must not be closed
+        shared_lock_guard _Guard(_Mylist._Lock());
+        _Mylist._Group()._Cancel_injected_tasks();
         _Mylist._For_each_thread(
             [](thread& _Thread) noexcept {
                 _Thread.cancel_all_pending_tasks();
@@ -383,31 +813,172 @@ void thread_pool::cancel_all_pending_tasks() noexcept {
 
 // FUNCTION thread_pool::schedule_task
 _NODISCARD_ATTR bool thread_pool::schedule_task(const thread::task _Task, void* const _Data) noexcept {
-    if (_Mystate == _Closed) { // scheduling inactive
+    return _Schedule_task(_Thread_task{_Task, _Data, task_priority::normal});
+}
+
+_NODISCARD_ATTR bool thread_pool::schedule_task(
+    const thread::task _Task, void* const _Data, const task_priority _Priority) noexcept {
+    return _Schedule_task(_Thread_task{_Task, _Data, _Priority});
+}
+
+// FUNCTION thread_pool::_Schedule_task
+_NODISCARD_ATTR bool thread_pool::_Schedule_task(const _Thread_task& _Task) noexcept {
+    if (_Load_state() == _Closed) { // scheduling inactive
         return false;
     }
 
+    _Thread_group& _Group = _Mylist._Group();
+    _Group._Begin_tasks(1); // must be counted before any thread can finish it
+    if (_Push_task(_Task)) {
+        return true;
+    }
+
+    _Group._Finish_tasks(1); // not scheduled
+    return false;
+}
+
+// FUNCTION thread_pool::_Push_task
+bool thread_pool::_Push_task(const _Thread_task& _Task) noexcept {
+    // Note: The deques and the injection queue ignore priorities, so only tasks with normal
+    //       priority can be scheduled there. Other tasks go to the selected thread's queue.
+    if (_Task._Priority == task_priority::normal) {
+        if (_Schedule_local_task(_Task)) { // scheduled by the pool's own thread
+            return true;
+        }
+
+        // Note: With idle_first, tasks scheduled by other threads are appended to the injection queue,
+        //       which is shared by all threads of the pool. The first idle thread takes them in batches.
+        //       Other policies select the thread themselves, like for tasks with other priorities.
+        if (_Mypolicy.load(_STD memory_order_relaxed) == scheduling_policy::idle_first) {
+            return _Mylist._Group()._Inject(_Task);
+        }
+    }
+
+    shared_lock_guard _Guard(_Mylist._Lock()); // the selected thread must not be dismissed meanwhile
     thread* const _Thread = _Select_ideal_thread();
-    return _Thread ? _Thread->schedule_task(_Task, _Data) : false;
+    return _Thread ? _Thread->_Schedule_task(_Task) : false;
 }
 
-_NODISCARD_ATTR bool thread_pool::schedule_task(
-    const thread::task _Task, void* const _Data, const task_priority _Priority) noexcept {
-    if (_Mystate == _Closed) { // scheduling inactive
+// FUNCTION thread_pool::_Schedule_continuation
+_NODISCARD_ATTR bool thread_pool::_Schedule_continuation(const _Thread_task& _Task) noexcept {
+    if (_Load_state() == _Closed) { // scheduling inactive
         return false;
     }
 
-    thread* const _Thread = _Select_ideal_thread();
-    return _Thread ? _Thread->schedule_task(_Task, _Data, _Priority) : false;
+    // Note: A continuation is usually scheduled by the pool's thread that has just finished
+    //       the previous task. That thread pops it from its deque next, so waking another
+    //       thread would only make them compete for it.
+    _Thread_cache* const _Cache = _Current_thread_cache();
+    _Thread_group& _Group       = _Mylist._Group();
+    if (_Task._Priority == task_priority::normal && _Cache
+        && _Cache->_Group.load(_STD memory_order_relaxed) == _TPLMGR addressof(_Group)) {
+        _Group._Begin_tasks(1);
+        if (_Cache->_Deque._Push(_Task)) {
+            return true;
+        }
+
+        _Group._Finish_tasks(1); // the deque is full, schedule it as any other task
+    }
+
+    return _Schedule_task(_Task);
+}
+
+// FUNCTION thread_pool::wait_idle
+bool thread_pool::wait_idle() noexcept {
+    return _Wait_idle(false, 0);
+}
+
+// FUNCTION thread_pool::wait_idle_for
+_NODISCARD_ATTR bool thread_pool::wait_idle_for(const uint32_t _Milliseconds) noexcept {
+    return _Wait_idle(true, _Milliseconds);
+}
+
+// FUNCTION thread_pool::_Wait_idle
+bool thread_pool::_Wait_idle(const bool _Timed, const uint32_t _Milliseconds) noexcept {
+    if (_Load_state() == _Closed) { // nothing to wait for
+        return false;
+    }
+
+    _Thread_cache* const _Cache = _Current_thread_cache();
+    _Thread_group& _Group       = _Mylist._Group();
+    if (_Cache && _Cache->_Group.load(_STD memory_order_relaxed) == _TPLMGR addressof(_Group)) {
+        return false; // the pool's own thread would wait for itself
+    }
+
+    return _Group._Wait_idle(_Timed, _Milliseconds);
+}
+
+// FUNCTION thread_pool::now
+uint64_t thread_pool::now() noexcept {
+    return _Tick_count();
+}
+
+// FUNCTION thread_pool::schedule_after
+_NODISCARD_ATTR thread_pool::timer_id thread_pool::schedule_after(
+    const uint64_t _Milliseconds, const thread::task _Task, void* const _Data) noexcept {
+    const uint64_t _Now = _Tick_count();
+    return schedule_at(_Milliseconds > UINT64_MAX - _Now ? UINT64_MAX : _Now + _Milliseconds, _Task, _Data);
+}
+
+// FUNCTION thread_pool::schedule_at
+_NODISCARD_ATTR thread_pool::timer_id thread_pool::schedule_at(
+    const uint64_t _Time, const thread::task _Task, void* const _Data) noexcept {
+    if (_Load_state() == _Closed) { // scheduling inactive
+        return 0;
+    }
+
+    return _Mytimers._Add(_Time, 0, _Thread_task{_Task, _Data, task_priority::normal});
+}
+
+// FUNCTION thread_pool::schedule_every
+_NODISCARD_ATTR thread_pool::timer_id thread_pool::schedule_every(
+    const uint32_t _Period, const thread::task _Task, void* const _Data) noexcept {
+    if (_Load_state() == _Closed || _Period == 0) { // scheduling inactive or invalid period
+        return 0;
+    }
+
+    return _Mytimers._Add(_Tick_count() + _Period, _Period, _Thread_task{_Task, _Data, task_priority::normal});
+}
+
+// FUNCTION thread_pool::cancel_timer
+bool thread_pool::cancel_timer(const timer_id _Id) noexcept {
+    return _Mytimers._Cancel(_Id);
+}
+
+// FUNCTION thread_pool::pending_timers
+size_t thread_pool::pending_timers() const noexcept {
+    return _Mytimers._Size();
+}
+
+// FUNCTION thread_pool::schedule_tasks
+size_t thread_pool::schedule_tasks(
+    const thread::task* const _Tasks, void* const* const _Data, const size_t _Count) noexcept {
+    return _Schedule_batch(_Task_batch{_Tasks, nullptr, _Data, _Count, task_priority::normal});
+}
+
+size_t thread_pool::schedule_tasks(const thread::task* const _Tasks, void* const* const _Data,
+    const size_t _Count, const task_priority _Priority) noexcept {
+    return _Schedule_batch(_Task_batch{_Tasks, nullptr, _Data, _Count, _Priority});
+}
+
+size_t thread_pool::schedule_tasks(
+    const thread::task _Task, void* const* const _Data, const size_t _Count) noexcept {
+    return _Schedule_batch(_Task_batch{nullptr, _Task, _Data, _Count, task_priority::normal});
+}
+
+size_t thread_pool::schedule_tasks(const thread::task _Task, void* const* const _Data,
+    const size_t _Count, const task_priority _Priority) noexcept {
+    return _Schedule_batch(_Task_batch{nullptr, _Task, _Data, _Count, _Priority});
 }
 
 // FUNCTION thread_pool::suspend
 _NODISCARD_ATTR bool thread_pool::suspend() noexcept {
-    if (_Mystate != _Working) { // must be working
+    if (_Load_state() != _Working) { // must be working
         return false;
     }
 
-    _Mystate = _Waiting;
+    shared_lock_guard _Guard(_Mylist._Lock());
+    _Mystate.store(_Waiting, _STD memory_order_release);
     _Mylist._For_each_thread( // try to suspend all threads
         [](thread& _Thread) noexcept {
             (void) _Thread.suspend();
@@ -418,11 +989,12 @@ _NODISCARD_ATTR bool thread_pool::suspend() noexcept {
 
 // FUNCTION thread_pool::resume
 _NODISCARD_ATTR bool thread_pool::resume() noexcept {
-    if (_Mystate != _Waiting) { // must be waiting
+    if (_Load_state() != _Waiting) { // must be waiting
         return false;
     }
 
-    _Mystate = _Working;
+    shared_lock_guard _Guard(_Mylist._Lock());
+    _Mystate.store(_Working, _STD memory_order_release);
     _Mylist._For_each_thread( // try to resume all threads
         [](thread& _Thread) noexcept {
             (void) _Thread.resume();
@@ -430,6 +1002,21 @@ _NODISCARD_ATTR bool thread_pool::resume() noexcept {
     );
     return true;
 }
+
+// FUNCTION blocking_region constructor/destructor
+blocking_region::blocking_region(thread_pool& _Pool) noexcept
+    : _Mypool(_Pool), _Myactive(_Pool.enter_blocking()) {}
+
+blocking_region::~blocking_region() noexcept {
+    if (_Myactive) {
+        _Mypool.leave_blocking();
+    }
+}
+
+// FUNCTION blocking_region::active
+bool blocking_region::active() const noexcept {
+    return _Myactive;
+}
 _TPLMGR_END
 
 #endif // _TPLMGR_PREPROCESSOR_GUARD
\ No newline at end of file
@@ -9,31 +9,29 @@
 #include <tplmgr/core.hpp>
 #if _TPLMGR_PREPROCESSOR_GUARD
 #include <tplmgr/allocator.hpp>
+#include <tplmgr/scaling_controller.hpp>
+#include <tplmgr/shared_lock.hpp>
 #include <tplmgr/thread.hpp>
+#include <tplmgr/timer_wheel.hpp>
 #include <tplmgr/utils.hpp>
 #include <cstddef>
+#include <cstdint>
+#if _HAS_CXX20_COROUTINES
+#include <coroutine>
+#endif // _HAS_CXX20_COROUTINES
 #include <type_traits>
 #include <utility>
 
 _TPLMGR_BEGIN
-// STRUCT _Thread_list_node
-struct _Thread_list_node {
-    _Thread_list_node() noexcept;
-    ~_Thread_list_node() noexcept;
+// CONSTANT _Compensation_delay
+_INLINE_VARIABLE constexpr uint32_t _Compensation_delay = 50; // milliseconds before retiring threads
 
-    _Thread_list_node* _Next; // pointer to the next node
-    _Thread_list_node* _Prev; // pointer to the previous node
-    thread _Thread;
-};
-
-// STRUCT _Thread_list_storage
-struct _Thread_list_storage {
-    _Thread_list_storage() noexcept;
-    ~_Thread_list_storage() noexcept;
+// STRUCT _Thread_record
+struct alignas(_Cache_line_size) _Thread_record { // thread stored in the contiguous array
+    _Thread_record(const thread_affinity _Affinity, const uint32_t _Binding) noexcept
+        : _Thread(_Affinity, _Binding) {}
 
-    _Thread_list_node* _Head; // pointer to the first node
-    _Thread_list_node* _Tail; // pointer to the last node
-    size_t _Size; // number of nodes
+    thread _Thread;
 };
 
 // CLASS _Thread_list
@@ -46,10 +44,14 @@ public:
     _Thread_list& operator=(const _Thread_list&) = delete;
 
     explicit _Thread_list(const size_t _Size) noexcept;
+    explicit _Thread_list(const size_t _Size, const thread_affinity _Affinity) noexcept;
 
     // returns the number of threads
     const size_t _Size() const noexcept;
 
+    // returns the affinity of new threads
+    thread_affinity _Affinity() const noexcept;
+
     // tries to hire _Count additional threads
     _NODISCARD_ATTR bool _Grow(size_t _Count) noexcept;
 
@@ -59,49 +61,123 @@ public:
     // dismisses all threads
     void _Release() noexcept;
 
+    // tries to dismiss _Count threads that have been idle since _Since (or earlier), returns the number of them
+    size_t _Dismiss_idle_threads(const size_t _Count, const uint64_t _Since) noexcept;
+
     // returns a pointer to the selected thread
-    thread* _Select_thread(size_t _Which) noexcept;
+    thread* _Select_thread(const size_t _Which) noexcept;
 
     // retursn a pointer to the thread with the specified ID
     thread* _Select_thread_by_id(const thread::id _Id) noexcept;
 
-    // returns a pointer to the first waiting thread
-    thread* _Select_any_waiting_thread() noexcept;
+    // returns the group of threads that steal tasks from each other
+    _Thread_group& _Group() noexcept;
 
-    // returns a pointer to the thread with the fewest pending threads
-    thread* _Select_thread_with_fewest_pending_tasks() noexcept;
+    // returns the lock that must be held (shared) while the threads are accessed
+    shared_lock& _Lock() const noexcept;
 
     template <class _Fn, class... _Types>
     void _For_each_thread(_Fn&& _Func, _Types&&... _Args) noexcept {
-        _Thread_list_storage& _Storage = _Mypair._Val1;
-        if (_Storage._Size > 0) {
-            _Thread_list_node* _Node = _Storage._Head;
-            while (_Node) {
-                (void) _Func(_Node->_Thread, _STD forward<_Types>(_Args)...);
-                _Node = _Node->_Next;
-            }
+        for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+            (void) _Func(_At(_Idx), _STD forward<_Types>(_Args)...);
         }
     }
 
 private:
     using _Alloc = allocator<void>;
 
-    // allocates a thread list node
-    _NODISCARD_ATTR static bool _Allocate_node(_Thread_list_node** const _Node, _Alloc& _Al) noexcept;
+    static constexpr size_t _Chunk_size = 16; // records per chunk
+
+    // returns the thread at the specified index
+    thread& _At(const size_t _Idx) noexcept {
+        const uint32_t _Slot = _Myslots[_Idx];
+        return _Mychunks[_Slot / _Chunk_size][_Slot % _Chunk_size]._Thread;
+    }
+
+    // tries to allocate one more chunk of records
+    _NODISCARD_ATTR bool _Allocate_chunk() noexcept;
+
+    // returns the least used processor or node (depends on the affinity) for a new thread
+    uint32_t _Next_binding() noexcept;
+
+    // tries to construct a new thread at the end of the list
+    _NODISCARD_ATTR bool _Construct_thread() noexcept;
 
-    // deallocates one node
-    void _Free_node(_Thread_list_node* _Node) noexcept;
+    // destroys the thread at the specified index, the following threads are shifted
+    void _Destroy_thread(const size_t _Idx) noexcept;
 
     // tries to reduce _Count waiting threads
     void _Reduce_waiting_threads(size_t& _Count) noexcept;
 
-    _Ebco_pair<_Thread_list_storage, _Alloc> _Mypair;
+    // Note: Running threads must never move, so records are stored in chunks that are never
+    //       reallocated. Each record occupies whole cache lines, so threads don't share them.
+    //       _Myslots maps an index to a record (O(1) lookup). The first _Mysize slots are used,
+    //       the remaining ones are free. _Mylock is held exclusively only while the arrays change,
+    //       not while a thread finishes its current task, so tasks can still schedule other tasks.
+    mutable shared_lock _Mylock;
+    _Thread_record** _Mychunks;
+    size_t _Mychunk_count;
+    uint32_t* _Myslots;
+    size_t _Mysize;
+    _Thread_group _Mygroup;
+    thread_affinity _Myaffinity;
+};
+
+// ENUM CLASS scheduling_policy
+// Note: The policy selects the thread for tasks scheduled by other threads than the pool's own ones.
+//       With idle_first, tasks with normal priority use the injection queue instead (any idle thread
+//       takes them). Tasks scheduled by the pool's threads with normal priority always go to their deques.
+enum class scheduling_policy : unsigned char {
+    idle_first, // any waiting thread, otherwise the less loaded of two random threads
+    round_robin, // threads in turn
+    power_of_two_choices, // the less loaded of two random threads
+    least_loaded, // the thread with the fewest pending tasks (scans all threads)
+    sticky // the same thread for the same scheduling thread (better cache locality)
 };
 
+// CLASS thread_pool
+class thread_pool;
+
+#if _HAS_CXX20_COROUTINES
+// CLASS _Schedule_awaiter
+class _Schedule_awaiter { // resumes the awaiting coroutine on one of the pool's threads
+public:
+    _Schedule_awaiter(thread_pool& _Pool, const task_priority _Priority) noexcept
+        : _Mypool(_TPLMGR addressof(_Pool)), _Mypriority(_Priority) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    // Note: The coroutine may be resumed by the pool before this function returns,
+    //       so the awaiter (a part of the coroutine's frame) must not be accessed after scheduling.
+    //       If the task can't be scheduled (e.g. the pool is closed), the coroutine continues
+    //       on the current thread.
+    bool await_suspend(const _STD coroutine_handle<> _Coro) noexcept;
+
+    void await_resume() const noexcept {}
+
+private:
+    static void __STDCALL_OR_CDECL _Resume(void* const _Data) {
+        _STD coroutine_handle<>::from_address(_Data).resume();
+    }
+
+    thread_pool* _Mypool;
+    task_priority _Mypriority;
+};
+#endif // _HAS_CXX20_COROUTINES
+
 // CLASS thread_pool
 class _TPLMGR_API thread_pool {
 public:
     explicit thread_pool(const size_t _Size) noexcept;
+    explicit thread_pool(const size_t _Size, const size_t _Spin_count) noexcept;
+    explicit thread_pool(const size_t _Size, const scheduling_policy _Policy) noexcept;
+    explicit thread_pool(
+        const size_t _Size, const size_t _Spin_count, const scheduling_policy _Policy) noexcept;
+    explicit thread_pool(const size_t _Size, const thread_affinity _Affinity) noexcept;
+    explicit thread_pool(const size_t _Size, const size_t _Spin_count,
+        const scheduling_policy _Policy, const thread_affinity _Affinity) noexcept;
     ~thread_pool() noexcept;
 
     thread_pool() = delete;
@@ -111,6 +187,21 @@ public:
     // returns the number of threads
     size_t threads() const noexcept;
 
+    // returns the number of spins before a waiting thread blocks
+    size_t spin_count() const noexcept;
+
+    // changes the number of spins before a waiting thread blocks
+    void set_spin_count(const size_t _Count) noexcept;
+
+    // returns the policy that selects threads for tasks scheduled by other threads (see scheduling_policy)
+    scheduling_policy policy() const noexcept;
+
+    // changes the policy that selects threads for tasks scheduled by other threads (see scheduling_policy)
+    void set_policy(const scheduling_policy _Policy) noexcept;
+
+    // returns the affinity of the threads (set in the constructor)
+    thread_affinity affinity() const noexcept;
+
     // checks if the thread-pool is still open
     bool is_open() const noexcept;
 
@@ -132,6 +223,12 @@ public:
     // collects the thread-pool's statistics
     _NODISCARD_ATTR statistics collect_statistics() noexcept;
 
+    // sums the counters of all threads, including the dismissed ones (doesn't block the threads)
+    _NODISCARD_ATTR thread_counters snapshot() noexcept;
+
+    // copies the counters of up to _Count threads (in no particular order), returns the number of threads
+    size_t snapshot(thread_counters* const _Counters, const size_t _Count) noexcept;
+
     // checks if the thread is in the pool
     bool is_thread_in_pool(const thread::id _Id) const noexcept;
 
@@ -144,6 +241,34 @@ public:
     // tries to resize the thread-pool
     _NODISCARD_ATTR bool resize(const size_t _New_size) noexcept;
 
+    // tries to start adjusting the number of threads automatically (or replaces the options)
+    _NODISCARD_ATTR bool enable_auto_scaling(const scaling_options& _Options) noexcept;
+
+    // stops adjusting the number of threads automatically, the current threads are kept
+    void disable_auto_scaling() noexcept;
+
+    // checks if the number of threads is adjusted automatically
+    bool is_auto_scaling() const noexcept;
+
+    // returns the state of the thread-pool (used by the scaling controller)
+    _Scaling_sample _Sample() noexcept;
+
+    // tries to dismiss _Count threads idle since _Since (used by the scaling controller)
+    size_t _Dismiss_idle_threads(const size_t _Count, const uint64_t _Since) noexcept;
+
+    // marks the start of a blocking call, a compensating thread may be hired meanwhile,
+    // fails if the thread-pool is closed or if not called by one of its threads
+    _NODISCARD_ATTR bool enter_blocking() noexcept;
+
+    // marks the end of a blocking call (must follow a successful enter_blocking())
+    void leave_blocking() noexcept;
+
+    // returns the maximum number of compensating threads
+    size_t compensation_limit() const noexcept;
+
+    // changes the maximum number of compensating threads (0 disables compensation)
+    void set_compensation_limit(const size_t _Limit) noexcept;
+
     // cancels all pending tasks
     void cancel_all_pending_tasks() noexcept;
 
@@ -154,6 +279,64 @@ public:
     _NODISCARD_ATTR bool schedule_task(
         const thread::task _Task, void* const _Data, const task_priority _Priority) noexcept;
 
+    // tries to schedule _Count new tasks, returns the number of scheduled tasks
+    size_t schedule_tasks(
+        const thread::task* const _Tasks, void* const* const _Data, const size_t _Count) noexcept;
+
+    // tries to schedule _Count new tasks (provides a hint about priority)
+    size_t schedule_tasks(const thread::task* const _Tasks, void* const* const _Data,
+        const size_t _Count, const task_priority _Priority) noexcept;
+
+    // tries to schedule _Count new tasks with the same function
+    size_t schedule_tasks(const thread::task _Task, void* const* const _Data, const size_t _Count) noexcept;
+
+    // tries to schedule _Count new tasks with the same function (provides a hint about priority)
+    size_t schedule_tasks(const thread::task _Task, void* const* const _Data,
+        const size_t _Count, const task_priority _Priority) noexcept;
+
+    // tries to schedule a new task (used by async())
+    _NODISCARD_ATTR bool _Schedule_task(const _Thread_task& _Task) noexcept;
+
+    // tries to schedule a continuation (used by task_future), see the definition for details
+    _NODISCARD_ATTR bool _Schedule_continuation(const _Thread_task& _Task) noexcept;
+
+    // blocks until all scheduled tasks have finished or been cancelled,
+    // fails if the thread-pool is closed or if called by one of its threads
+    bool wait_idle() noexcept;
+
+    // same as wait_idle(), but fails if the tasks haven't finished within _Milliseconds
+    _NODISCARD_ATTR bool wait_idle_for(const uint32_t _Milliseconds) noexcept;
+
+    using timer_id = uint64_t;
+
+    // returns the current time in milliseconds (the clock used by the timers)
+    static uint64_t now() noexcept;
+
+    // tries to schedule a new task after _Milliseconds, returns 0 on failure
+    _NODISCARD_ATTR timer_id schedule_after(
+        const uint64_t _Milliseconds, const thread::task _Task, void* const _Data) noexcept;
+
+    // tries to schedule a new task at _Time (see now()), returns 0 on failure
+    _NODISCARD_ATTR timer_id schedule_at(
+        const uint64_t _Time, const thread::task _Task, void* const _Data) noexcept;
+
+    // tries to schedule a new task every _Period milliseconds, returns 0 on failure
+    _NODISCARD_ATTR timer_id schedule_every(
+        const uint32_t _Period, const thread::task _Task, void* const _Data) noexcept;
+
+    // tries to cancel the timer, fails if its task has already been scheduled (and doesn't repeat)
+    bool cancel_timer(const timer_id _Id) noexcept;
+
+    // returns the number of timers that haven't been scheduled yet
+    size_t pending_timers() const noexcept;
+
+#if _HAS_CXX20_COROUTINES
+    // returns an awaitable that resumes the awaiting coroutine on one of the pool's threads
+    _NODISCARD_ATTR _Schedule_awaiter schedule(const task_priority _Priority = task_priority::normal) noexcept {
+        return _Schedule_awaiter{*this, _Priority};
+    }
+#endif // _HAS_CXX20_COROUTINES
+
     // tries to suspend the thread-pool
     _NODISCARD_ATTR bool suspend() noexcept;
 
@@ -167,12 +350,92 @@ private:
         _Working
     };
 
+    // returns the state (it's read by the pool's threads and the scaling controller as well)
+    _Internal_state _Load_state() const noexcept {
+        return _Mystate.load(_STD memory_order_relaxed);
+    }
+
     // returns a pointer to the best thread for task scheduling
     thread* _Select_ideal_thread() noexcept;
 
+    // pushes the task to the appropriate queue (the task must be counted already)
+    bool _Push_task(const _Thread_task& _Task) noexcept;
+
+    // waits for all scheduled tasks, optionally with a timeout
+    bool _Wait_idle(const bool _Timed, const uint32_t _Milliseconds) noexcept;
+
+    // tries to schedule a new task in the current thread's deque (if the thread is in the pool)
+    bool _Schedule_local_task(const _Thread_task& _Task) noexcept;
+
+    // tries to schedule the batch in the current thread's deque (if the thread is in the pool)
+    bool _Schedule_local_tasks(const _Task_batch& _Batch) noexcept;
+
+    // tries to schedule the batch, returns the number of scheduled tasks
+    size_t _Schedule_batch(const _Task_batch& _Batch) noexcept;
+
+    // applies the spin count to all threads (the list's lock or _Mylock must be held)
+    void _Apply_spin_count() noexcept;
+
+    // tries to hire _Count new threads (the lock must be held, at least in shared mode)
+    bool _Increase_threads(const size_t _Count) noexcept;
+
+    // tries to dismiss _Count threads (the lock must be held)
+    bool _Decrease_threads(const size_t _Count) noexcept;
+
+    // schedules the retirement of surplus compensating threads (unless already scheduled)
+    void _Schedule_retirement() noexcept;
+
+    // tries to dismiss compensating threads that are no longer needed (called by a pool's thread)
+    void _Retire_compensating_threads() noexcept;
+
+    static void __STDCALL_OR_CDECL _Retire_handler(void* const _Data) {
+        static_cast<thread_pool*>(_Data)->_Retire_compensating_threads();
+    }
+
+    // Note: Threads can be added and removed by the scaling controller while other threads
+    //       schedule tasks, so the list's lock is held (shared) while a selected thread is used.
+    //       _Mylock serializes the operations that add or remove threads. Compensating threads
+    //       are hired with _Mylock held in shared mode, since appending threads doesn't disturb
+    //       other appends, only removals.
+
     mutable _Thread_list _Mylist;
-    _Internal_state _Mystate;
+    shared_lock _Mylock;
+    atomic<_Internal_state> _Mystate;
+    size_t _Myspin;
+    atomic<scheduling_policy> _Mypolicy;
+    atomic<size_t> _Mynext; // the next thread (round-robin)
+    atomic<size_t> _Myblocked; // tasks inside blocking regions
+    atomic<size_t> _Mycompensating; // threads hired for blocked tasks
+    atomic<size_t> _Mycompensation_limit;
+    atomic<bool> _Myretiring; // the retirement is scheduled
+    _Timer_wheel _Mytimers;
+    _Scaling_controller _Myscaler;
+};
+
+// CLASS blocking_region
+class _TPLMGR_API _NODISCARD_ATTR blocking_region { // marks a blocking call in one of the pool's tasks
+public:
+    explicit blocking_region(thread_pool& _Pool) noexcept;
+    ~blocking_region() noexcept;
+
+    blocking_region() = delete;
+    blocking_region(const blocking_region&) = delete;
+    blocking_region& operator=(const blocking_region&) = delete;
+
+    // checks if the region has been entered (see thread_pool::enter_blocking())
+    bool active() const noexcept;
+
+private:
+    thread_pool& _Mypool;
+    bool _Myactive;
 };
+
+#if _HAS_CXX20_COROUTINES
+// FUNCTION _Schedule_awaiter::await_suspend
+inline bool _Schedule_awaiter::await_suspend(const _STD coroutine_handle<> _Coro) noexcept {
+    return _Mypool->_Schedule_task(_Thread_task{&_Resume, _Coro.address(), _Mypriority});
+}
+#endif // _HAS_CXX20_COROUTINES
 _TPLMGR_END
 
 #endif // _TPLMGR_PREPROCESSOR_GUARD
@@ -0,0 +1,391 @@
+// timer_wheel.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <tplmgr/tplmgr_pch.hpp>
+#include <tplmgr/thread_pool.hpp>
+#include <tplmgr/timer_wheel.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+
+_TPLMGR_BEGIN
+// FUNCTION _Init_list
+static void _Init_list(_Timer_link& _Head) noexcept {
+    _Head._Prev = _TPLMGR addressof(_Head);
+    _Head._Next = _TPLMGR addressof(_Head);
+}
+
+// FUNCTION _Link_before
+static void _Link_before(_Timer_link& _Head, _Timer_link* const _Link) noexcept {
+    _Link->_Prev        = _Head._Prev;
+    _Link->_Next        = _TPLMGR addressof(_Head);
+    _Head._Prev->_Next  = _Link;
+    _Head._Prev         = _Link;
+}
+
+// FUNCTION _Unlink
+static void _Unlink(_Timer_link* const _Link) noexcept {
+    _Link->_Prev->_Next = _Link->_Next;
+    _Link->_Next->_Prev = _Link->_Prev;
+    _Link->_Prev        = nullptr; // marks the node as unlinked
+    _Link->_Next        = nullptr;
+}
+
+// FUNCTION _Splice_back
+static void _Splice_back(_Timer_link& _Target, _Timer_link& _Source) noexcept {
+    if (_Source._Next == _TPLMGR addressof(_Source)) { // nothing to move
+        return;
+    }
+
+    _Source._Next->_Prev = _Target._Prev;
+    _Target._Prev->_Next = _Source._Next;
+    _Source._Prev->_Next = _TPLMGR addressof(_Target);
+    _Target._Prev        = _Source._Prev;
+    _Init_list(_Source);
+}
+
+// FUNCTION _Timer_wheel constructor/destructor
+_Timer_wheel::_Timer_wheel(thread_pool& _Pool) noexcept
+    : _Mypool(_TPLMGR addressof(_Pool)), _Mylock(), _Myslots(nullptr), _Myexpired(), _Mychunks(nullptr),
+    _Mychunk_count(0), _Myfree(nullptr), _Mysize(0), _Myscheduled(0), _Mycurrent(0), _Mywakeup(UINT64_MAX),
+    _Mythread(nullptr), _Mythread_id(0), _Mystopped(false), _Mysignal(0) {
+    _Init_list(_Myexpired);
+}
+
+_Timer_wheel::~_Timer_wheel() noexcept {
+    _Stop();
+}
+
+// FUNCTION _Timer_wheel::_Timer_handler
+unsigned long __stdcall _Timer_wheel::_Timer_handler(void* const _Data) noexcept {
+    static_cast<_Timer_wheel*>(_Data)->_Run();
+    return 0;
+}
+
+// FUNCTION _Timer_wheel::_Start
+_NODISCARD_ATTR bool _Timer_wheel::_Start() noexcept {
+    _Alloc _Al;
+    _Myslots = static_cast<_Timer_link*>(_Al.allocate(_Timer_levels * _Timer_slots * sizeof(_Timer_link)));
+    if (!_Myslots) { // allocation failed
+        return false;
+    }
+
+    for (uint32_t _Idx = 0; _Idx < _Timer_levels * _Timer_slots; ++_Idx) {
+        _Init_list(_Myslots[_Idx]);
+    }
+
+    _Mycurrent = _Tick_count();
+    _Mythread  = _Create_thread(&_Timer_handler, this, _TPLMGR addressof(_Mythread_id));
+    if (!_Mythread) { // the timer thread couldn't be started
+        _Al.deallocate(_Myslots, _Timer_levels * _Timer_slots * sizeof(_Timer_link));
+        _Myslots = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+// FUNCTION _Timer_wheel::_Allocate_node
+_Timer_node* _Timer_wheel::_Allocate_node() noexcept {
+    if (!_Myfree) { // no free node, allocate a new chunk
+        if (_Mychunk_count >= UINT32_MAX / _Chunk_size) { // the index must fit in 32 bits
+            return nullptr;
+        }
+
+        _Alloc _Al;
+        void* const _Raw_chunks = _Al.allocate((_Mychunk_count + 1) * sizeof(_Timer_node*));
+        if (!_Raw_chunks) { // allocation failed
+            return nullptr;
+        }
+
+        void* const _Raw_nodes = _Al.allocate(_Chunk_size * sizeof(_Timer_node));
+        if (!_Raw_nodes) { // allocation failed
+            _Al.deallocate(_Raw_chunks, (_Mychunk_count + 1) * sizeof(_Timer_node*));
+            return nullptr;
+        }
+
+        _Timer_node** const _New_chunks = static_cast<_Timer_node**>(_Raw_chunks);
+        for (size_t _Idx = 0; _Idx < _Mychunk_count; ++_Idx) {
+            _New_chunks[_Idx] = _Mychunks[_Idx];
+        }
+
+        _Timer_node* const _Nodes = static_cast<_Timer_node*>(_Raw_nodes);
+        for (size_t _Idx = _Chunk_size; _Idx-- > 0;) { // link the new nodes, the first one on top
+            _Timer_node* const _Node = ::new (static_cast<void*>(_Nodes + _Idx)) _Timer_node;
+            _Node->_Prev             = nullptr;
+            _Node->_Next             = _Myfree;
+            _Node->_Index            = static_cast<uint32_t>(_Mychunk_count * _Chunk_size + _Idx);
+            _Node->_Generation       = 1;
+            _Myfree                  = _Node;
+        }
+
+        _New_chunks[_Mychunk_count] = _Nodes;
+        if (_Mychunks) {
+            _Al.deallocate(_Mychunks, _Mychunk_count * sizeof(_Timer_node*));
+        }
+
+        _Mychunks = _New_chunks;
+        ++_Mychunk_count;
+    }
+
+    _Timer_node* const _Node = _Myfree;
+    _Myfree                  = static_cast<_Timer_node*>(_Node->_Next);
+    _Node->_Next             = nullptr;
+    ++_Mysize;
+    return _Node;
+}
+
+// FUNCTION _Timer_wheel::_Free_node
+void _Timer_wheel::_Free_node(_Timer_node* const _Node) noexcept {
+    if (++_Node->_Generation == 0) { // 0 never appears in an ID
+        _Node->_Generation = 1;
+    }
+
+    _Node->_Prev = nullptr;
+    _Node->_Next = _Myfree;
+    _Myfree      = _Node;
+    --_Mysize;
+}
+
+// FUNCTION _Timer_wheel::_Insert
+void _Timer_wheel::_Insert(_Timer_node* const _Node) noexcept {
+    if (_Node->_Expiry <= _Mycurrent) { // already due
+        _Node->_Due = true;
+        _Link_before(_Myexpired, _Node);
+        return;
+    }
+
+    // Note: Timers beyond the highest level are placed into its last slot and reinserted
+    //       once the slot is cascaded.
+    const uint64_t _Delta = _Node->_Expiry - _Mycurrent;
+    uint32_t _Level       = 0;
+    while (_Level < _Timer_levels - 1 && _Delta >= (uint64_t{1} << ((_Level + 1) * _Timer_slot_bits))) {
+        ++_Level;
+    }
+
+    const uint64_t _Max_delta = (uint64_t{1} << (_Timer_levels * _Timer_slot_bits)) - 1;
+    const uint64_t _Target    = _Delta > _Max_delta ? _Mycurrent + _Max_delta : _Node->_Expiry;
+    const uint32_t _Slot      = static_cast<uint32_t>(_Target >> (_Level * _Timer_slot_bits)) & (_Timer_slots - 1);
+    _Node->_Due = false;
+    _Link_before(_Myslots[_Level * _Timer_slots + _Slot], _Node);
+    ++_Myscheduled;
+}
+
+// FUNCTION _Timer_wheel::_Cascade
+void _Timer_wheel::_Cascade(const uint32_t _Level, const uint32_t _Slot) noexcept {
+    _Timer_link _List;
+    _Init_list(_List);
+    _Splice_back(_List, _Myslots[_Level * _Timer_slots + _Slot]);
+    while (_List._Next != _TPLMGR addressof(_List)) {
+        _Timer_node* const _Node = static_cast<_Timer_node*>(_List._Next);
+        _Unlink(_Node);
+        --_Myscheduled;
+        _Insert(_Node);
+    }
+}
+
+// FUNCTION _Timer_wheel::_Advance
+void _Timer_wheel::_Advance(const uint64_t _Now) noexcept {
+    while (_Mycurrent < _Now) {
+        if (_Myscheduled == 0) { // nothing to expire, skip the remaining ticks
+            _Mycurrent = _Now;
+            break;
+        }
+
+        ++_Mycurrent;
+        uint64_t _Tick = _Mycurrent;
+        for (uint32_t _Level = 1; _Level < _Timer_levels && (_Tick & (_Timer_slots - 1)) == 0; ++_Level) {
+            _Tick >>= _Timer_slot_bits; // the lower level wrapped around, cascade the next slot
+            _Cascade(_Level, static_cast<uint32_t>(_Tick) & (_Timer_slots - 1));
+        }
+
+        _Timer_link& _Slot = _Myslots[static_cast<uint32_t>(_Mycurrent) & (_Timer_slots - 1)];
+        for (_Timer_link* _Link = _Slot._Next; _Link != _TPLMGR addressof(_Slot); _Link = _Link->_Next) {
+            static_cast<_Timer_node*>(_Link)->_Due = true;
+            --_Myscheduled;
+        }
+
+        _Splice_back(_Myexpired, _Slot);
+    }
+}
+
+// FUNCTION _Timer_wheel::_Next_timeout
+uint32_t _Timer_wheel::_Next_timeout() const noexcept {
+    if (_Myscheduled == 0) { // nothing to wait for
+        return UINT32_MAX;
+    }
+
+    // Note: Only the lowest level is searched, the thread wakes up at least once per its
+    //       revolution (_Timer_slots ticks) to cascade higher levels.
+    const uint32_t _Current = static_cast<uint32_t>(_Mycurrent) & (_Timer_slots - 1);
+    const uint32_t _Wrap    = _Timer_slots - _Current;
+    for (uint32_t _Delta = 1; _Delta < _Wrap; ++_Delta) {
+        const _Timer_link& _Slot = _Myslots[_Current + _Delta];
+        if (_Slot._Next != _TPLMGR addressof(_Slot)) {
+            return _Delta;
+        }
+    }
+
+    return _Wrap;
+}
+
+// FUNCTION _Timer_wheel::_Run
+void _Timer_wheel::_Run() noexcept {
+    _Thread_task _Batch[_Dispatch_batch];
+    for (;;) {
+        size_t _Count    = 0;
+        uint32_t _Signal = 0;
+        uint32_t _Timeout = 0;
+        {
+            lock_guard _Guard(_Mylock);
+            if (_Mystopped) { // the wheel is being destroyed
+                return;
+            }
+
+            _Signal = _Mysignal.load(_STD memory_order_relaxed);
+            _Advance(_Tick_count());
+            while (_Count < _Dispatch_batch && _Myexpired._Next != _TPLMGR addressof(_Myexpired)) {
+                _Timer_node* const _Node = static_cast<_Timer_node*>(_Myexpired._Next);
+                _Unlink(_Node);
+                _Batch[_Count++] = _Node->_Task;
+                if (_Node->_Period > 0) { // periodic, keep the phase unless some periods have been missed
+                    _Node->_Expiry += _Node->_Period;
+                    if (_Node->_Expiry <= _Mycurrent) {
+                        _Node->_Expiry = _Mycurrent + _Node->_Period;
+                    }
+
+                    _Insert(_Node);
+                } else {
+                    _Free_node(_Node);
+                }
+            }
+
+            if (_Count == 0) { // sleep until the next tick with some timers
+                _Timeout  = _Next_timeout();
+                _Mywakeup = _Timeout == UINT32_MAX ? UINT64_MAX : _Mycurrent + _Timeout;
+            }
+        }
+
+        if (_Count > 0) { // schedule the tasks outside the lock, then look for more
+            for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                (void) _Mypool->_Schedule_task(_Batch[_Idx]);
+            }
+
+            continue;
+        }
+
+        if (_Timeout == UINT32_MAX) {
+            _Wait_on_address(_Mysignal, _Signal);
+        } else {
+            (void) _Wait_on_address_for(_Mysignal, _Signal, _Timeout);
+        }
+    }
+}
+
+// FUNCTION _Timer_wheel::_Add
+uint64_t _Timer_wheel::_Add(const uint64_t _Expiry, const uint32_t _Period, const _Thread_task& _Task) noexcept {
+    lock_guard _Guard(_Mylock);
+    if (_Mystopped) { // no more timers
+        return 0;
+    }
+
+    if (!_Myslots && !_Start()) { // the first timer, start the timer thread
+        return 0;
+    }
+
+    _Timer_node* const _Node = _Allocate_node();
+    if (!_Node) { // allocation failed
+        return 0;
+    }
+
+    // Note: The timer thread doesn't advance the wheel while no timer is pending, so the current
+    //       tick may be stale. It's moved to now (all slots are empty), otherwise the next advance
+    //       would step through the whole idle gap under the lock.
+    if (_Myscheduled == 0 && _Myexpired._Next == _TPLMGR addressof(_Myexpired)) {
+        _Mycurrent = (_STD max)(_Mycurrent, _Tick_count());
+    }
+
+    _Node->_Task   = _Task;
+    _Node->_Expiry = _Expiry;
+    _Node->_Period = _Period;
+    _Insert(_Node);
+    if (_Expiry < _Mywakeup) { // the timer thread would sleep too long, wake it
+        _Mywakeup = _Expiry;
+        _Mysignal.fetch_add(1, _STD memory_order_relaxed);
+        _Wake_by_address_single(_Mysignal);
+    }
+
+    return (uint64_t{_Node->_Generation} << 32) | (uint64_t{_Node->_Index} + 1);
+}
+
+// FUNCTION _Timer_wheel::_Cancel
+bool _Timer_wheel::_Cancel(const uint64_t _Id) noexcept {
+    lock_guard _Guard(_Mylock);
+    const uint64_t _Index = _Id & 0xFFFF'FFFF; // 1-based
+    if (_Index == 0 || _Index > _Mychunk_count * _Chunk_size) { // not a valid ID
+        return false;
+    }
+
+    _Timer_node* const _Node = _Mychunks[(_Index - 1) / _Chunk_size] + (_Index - 1) % _Chunk_size;
+    if (!_Node->_Prev || _Node->_Generation != static_cast<uint32_t>(_Id >> 32)) { // not pending anymore
+        return false;
+    }
+
+    if (!_Node->_Due) { // still in some slot
+        --_Myscheduled;
+    }
+
+    _Unlink(_Node);
+    _Free_node(_Node);
+    return true;
+}
+
+// FUNCTION _Timer_wheel::_Size
+size_t _Timer_wheel::_Size() const noexcept {
+    shared_lock_guard _Guard(_Mylock);
+    return _Mysize;
+}
+
+// FUNCTION _Timer_wheel::_Stop
+void _Timer_wheel::_Stop() noexcept {
+    {
+        lock_guard _Guard(_Mylock);
+        if (_Mystopped) { // already stopped
+            return;
+        }
+
+        _Mystopped = true;
+        _Mysignal.fetch_add(1, _STD memory_order_relaxed);
+        _Wake_by_address_single(_Mysignal);
+    }
+
+    if (_Mythread) { // wait until the timer thread exits
+        _Wait_for_thread(_Mythread);
+        _Close_thread(_Mythread);
+        _Mythread = nullptr;
+    }
+
+    _Alloc _Al;
+    for (size_t _Idx = 0; _Idx < _Mychunk_count; ++_Idx) {
+        _Al.deallocate(_Mychunks[_Idx], _Chunk_size * sizeof(_Timer_node));
+    }
+
+    if (_Mychunks) {
+        _Al.deallocate(_Mychunks, _Mychunk_count * sizeof(_Timer_node*));
+        _Mychunks      = nullptr;
+        _Mychunk_count = 0;
+    }
+
+    if (_Myslots) {
+        _Al.deallocate(_Myslots, _Timer_levels * _Timer_slots * sizeof(_Timer_link));
+        _Myslots = nullptr;
+    }
+
+    _Init_list(_Myexpired);
+    _Myfree      = nullptr;
+    _Mysize      = 0;
+    _Myscheduled = 0;
+}
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
\ No newline at end of file
@@ -0,0 +1,127 @@
+// timer_wheel.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_TIMER_WHEEL_HPP_
+#define _TPLMGR_TIMER_WHEEL_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/shared_lock.hpp>
+#include <tplmgr/thread.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// CONSTANT _Timer_slot_bits
+_INLINE_VARIABLE constexpr uint32_t _Timer_slot_bits = 6;
+
+// CONSTANT _Timer_slots
+_INLINE_VARIABLE constexpr uint32_t _Timer_slots = uint32_t{1} << _Timer_slot_bits; // slots per level
+
+// CONSTANT _Timer_levels
+_INLINE_VARIABLE constexpr uint32_t _Timer_levels = 5; // covers 2^30 ms (about 12 days)
+
+// STRUCT _Timer_link
+struct _Timer_link { // link of a circular list, each slot is the list's head
+    _Timer_link* _Prev;
+    _Timer_link* _Next;
+};
+
+// STRUCT _Timer_node
+struct _Timer_node : _Timer_link { // pending timer
+    _Thread_task _Task;
+    uint64_t _Expiry; // tick at which the task is scheduled
+    uint32_t _Period; // milliseconds between runs, 0 if the timer runs once
+    uint32_t _Index; // index in the chunks, the lower part of the timer's ID
+    uint32_t _Generation; // incremented each time the node is freed, the upper part of the timer's ID
+    bool _Due; // true if the node is in the list of expired timers, not in some slot
+};
+
+// CLASS thread_pool
+class thread_pool;
+
+// CLASS _Timer_wheel
+class _Timer_wheel { // hierarchical timing wheel, serviced by one timer thread
+public:
+    explicit _Timer_wheel(thread_pool& _Pool) noexcept;
+    ~_Timer_wheel() noexcept;
+
+    _Timer_wheel(const _Timer_wheel&) = delete;
+    _Timer_wheel& operator=(const _Timer_wheel&) = delete;
+
+    // tries to add a timer that schedules _Task at _Expiry (see _Tick_count()), returns 0 on failure
+    uint64_t _Add(const uint64_t _Expiry, const uint32_t _Period, const _Thread_task& _Task) noexcept;
+
+    // tries to cancel the timer, fails if it has already been scheduled (and doesn't repeat)
+    bool _Cancel(const uint64_t _Id) noexcept;
+
+    // returns the number of pending timers
+    size_t _Size() const noexcept;
+
+    // stops the timer thread and discards all pending timers, no timer can be added later
+    void _Stop() noexcept;
+
+private:
+    using _Alloc = allocator<void>;
+
+    static constexpr size_t _Chunk_size     = 1024; // nodes per chunk
+    static constexpr size_t _Dispatch_batch = 16; // tasks scheduled per lock acquisition
+
+    static unsigned long __stdcall _Timer_handler(void* const _Data) noexcept;
+
+    // schedules the expired tasks and sleeps until the next tick that has some timers
+    void _Run() noexcept;
+
+    // tries to allocate the slots and start the timer thread (called once)
+    _NODISCARD_ATTR bool _Start() noexcept;
+
+    // tries to take a free node, allocates a new chunk if there is none
+    _Timer_node* _Allocate_node() noexcept;
+
+    // returns the node to the free list, its ID becomes invalid
+    void _Free_node(_Timer_node* const _Node) noexcept;
+
+    // inserts the node into the slot that matches its expiry
+    void _Insert(_Timer_node* const _Node) noexcept;
+
+    // moves the current tick to _Now, expired timers are moved to _Myexpired
+    void _Advance(const uint64_t _Now) noexcept;
+
+    // reinserts all timers of the slot into lower levels
+    void _Cascade(const uint32_t _Level, const uint32_t _Slot) noexcept;
+
+    // returns the number of milliseconds until the next tick that must be processed
+    uint32_t _Next_timeout() const noexcept;
+
+    // Note: Each level has _Timer_slots slots, a slot of level N covers _Timer_slots^N ticks.
+    //       A timer is inserted into the lowest level that covers its delay, so insertion and
+    //       cancellation are O(1). When a level wraps around, the next slot of the level above
+    //       is cascaded (its timers are reinserted into lower levels). Timers that are due
+    //       wait in _Myexpired until the timer thread schedules them.
+    thread_pool* _Mypool;
+    mutable shared_lock _Mylock;
+    _Timer_link* _Myslots; // _Timer_levels * _Timer_slots heads (allocated on first use)
+    _Timer_link _Myexpired;
+    _Timer_node** _Mychunks;
+    size_t _Mychunk_count;
+    _Timer_node* _Myfree; // free nodes, linked by _Next
+    size_t _Mysize; // pending timers (in the slots or in _Myexpired)
+    size_t _Myscheduled; // timers in the slots
+    uint64_t _Mycurrent; // the last processed tick
+    uint64_t _Mywakeup; // tick at which the timer thread wakes up
+    void* _Mythread;
+    unsigned int _Mythread_id;
+    bool _Mystopped;
+    atomic<uint32_t> _Mysignal; // changed to wake the timer thread
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_TIMER_WHEEL_HPP_
\ No newline at end of file
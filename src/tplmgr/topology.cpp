@@ -0,0 +1,266 @@
+// topology.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <tplmgr/tplmgr_pch.hpp>
+#include <tplmgr/topology.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+
+_TPLMGR_BEGIN
+// FUNCTION _Cpu_topology constructor
+_Cpu_topology::_Cpu_topology() noexcept : _Mycpus(), _Mynodes(), _Mynode_begin(), _Mycpu_count(0), _Mynode_count(0) {
+    _Read();
+}
+
+// FUNCTION _Cpu_topology::_Get
+const _Cpu_topology& _Cpu_topology::_Get() noexcept {
+    static const _Cpu_topology _Topology;
+    return _Topology;
+}
+
+// FUNCTION _Cpu_topology::_Cpu_count
+uint32_t _Cpu_topology::_Cpu_count() const noexcept {
+    return _Mycpu_count;
+}
+
+// FUNCTION _Cpu_topology::_Node_count
+uint32_t _Cpu_topology::_Node_count() const noexcept {
+    return _Mynode_count;
+}
+
+// FUNCTION _Cpu_topology::_Node_of
+uint32_t _Cpu_topology::_Node_of(const uint32_t _Cpu) const noexcept {
+    return _Cpu < _Max_cpus ? _Mynodes[_Cpu] : 0;
+}
+
+// FUNCTION _Cpu_topology::_Node_size
+uint32_t _Cpu_topology::_Node_size(const uint32_t _Node) const noexcept {
+    return _Node < _Mynode_count ? _Mynode_begin[_Node + 1] - _Mynode_begin[_Node] : 0;
+}
+
+// FUNCTION _Cpu_topology::_Node_cpus
+const uint16_t* _Cpu_topology::_Node_cpus(const uint32_t _Node) const noexcept {
+    return _Mycpus + _Mynode_begin[_Node < _Mynode_count ? _Node : 0];
+}
+
+// FUNCTION _Cpu_topology::_Spread_cpu
+uint32_t _Cpu_topology::_Spread_cpu(uint32_t _Idx) const noexcept {
+    // Note: The first processors of all nodes come first, then the second ones etc., so that
+    //       a few threads use the caches and the memory bandwidth of all nodes.
+    _Idx %= _Mycpu_count;
+    for (uint32_t _Round = 0;; ++_Round) {
+        for (uint32_t _Node = 0; _Node < _Mynode_count; ++_Node) {
+            if (_Node_size(_Node) > _Round) {
+                if (_Idx == 0) {
+                    return _Mycpus[_Mynode_begin[_Node] + _Round];
+                }
+
+                --_Idx;
+            }
+        }
+    }
+}
+
+#ifdef _WIN32
+// FUNCTION _Cpu_topology::_Read
+void _Cpu_topology::_Read() noexcept {
+    // Note: Only the processor group of the process is used, so at most 64 processors.
+    DWORD_PTR _Process_mask = 0;
+    DWORD_PTR _System_mask  = 0;
+    if (!::GetProcessAffinityMask(
+        ::GetCurrentProcess(), _TPLMGR addressof(_Process_mask), _TPLMGR addressof(_System_mask))) {
+        _Process_mask = 1; // assume that at least the first processor is usable
+    }
+
+    USHORT _System_nodes[_Max_numa_nodes]; // node numbers reported by the system
+    uint32_t _Node_sizes[_Max_numa_nodes] = {};
+    uint16_t _Found[_Max_cpus];
+    uint32_t _Found_count = 0;
+    for (uint32_t _Cpu = 0; _Cpu < sizeof(DWORD_PTR) * 8; ++_Cpu) {
+        if (!(_Process_mask & (DWORD_PTR{1} << _Cpu))) { // not usable
+            continue;
+        }
+
+        PROCESSOR_NUMBER _Number = {};
+        _Number.Number           = static_cast<BYTE>(_Cpu);
+        USHORT _System_node      = 0;
+        if (!::GetNumaProcessorNodeEx(_TPLMGR addressof(_Number), _TPLMGR addressof(_System_node))
+            || _System_node == 0xFFFF) { // unknown node
+            _System_node = 0;
+        }
+
+        uint32_t _Node = 0;
+        while (_Node < _Mynode_count && _System_nodes[_Node] != _System_node) {
+            ++_Node;
+        }
+
+        if (_Node == _Mynode_count) { // a new node
+            if (_Mynode_count < _Max_numa_nodes) {
+                _System_nodes[_Mynode_count++] = _System_node;
+            } else {
+                _Node = 0;
+            }
+        }
+
+        _Mynodes[_Cpu]        = static_cast<uint8_t>(_Node);
+        _Found[_Found_count++] = static_cast<uint16_t>(_Cpu);
+        ++_Node_sizes[_Node];
+    }
+
+    _Sort_by_node(_Found, _Found_count, _Node_sizes);
+}
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+// FUNCTION _Read_cpu_node
+static int _Read_cpu_node(const uint32_t _Cpu) noexcept {
+    // Note: Each processor's directory contains a "nodeN" link to its NUMA node,
+    //       the link is missing if the kernel doesn't support NUMA.
+    char _Path[64]                  = "/sys/devices/system/cpu/cpu";
+    static constexpr size_t _Prefix = sizeof("/sys/devices/system/cpu/cpu") - 1;
+    char _Digits[10];
+    size_t _Count = 0;
+    uint32_t _Val = _Cpu;
+    do {
+        _Digits[_Count++] = static_cast<char>('0' + _Val % 10);
+        _Val /= 10;
+    } while (_Val > 0);
+
+    for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+        _Path[_Prefix + _Idx] = _Digits[_Count - 1 - _Idx];
+    }
+
+    _Path[_Prefix + _Count] = '\0';
+    DIR* const _Dir         = ::opendir(_Path);
+    if (!_Dir) { // no information about the processor
+        return -1;
+    }
+
+    int _Node = -1;
+    while (const dirent* const _Entry = ::readdir(_Dir)) {
+        const char* _Name = _Entry->d_name;
+        if (_Name[0] != 'n' || _Name[1] != 'o' || _Name[2] != 'd' || _Name[3] != 'e'
+            || _Name[4] < '0' || _Name[4] > '9') { // not a node link
+            continue;
+        }
+
+        _Node = 0;
+        for (_Name += 4; *_Name >= '0' && *_Name <= '9' && _Node < 0x10000; ++_Name) {
+            _Node = _Node * 10 + (*_Name - '0');
+        }
+
+        break;
+    }
+
+    ::closedir(_Dir);
+    return _Node;
+}
+
+// FUNCTION _Cpu_topology::_Read
+void _Cpu_topology::_Read() noexcept {
+    cpu_set_t _Set;
+    CPU_ZERO(_TPLMGR addressof(_Set));
+    if (::sched_getaffinity(0, sizeof(cpu_set_t), _TPLMGR addressof(_Set)) != 0) {
+        CPU_SET(0, _TPLMGR addressof(_Set)); // assume that at least the first processor is usable
+    }
+
+    int _System_nodes[_Max_numa_nodes]; // node numbers reported by the system
+    uint32_t _Node_sizes[_Max_numa_nodes] = {};
+    uint16_t _Found[_Max_cpus];
+    uint32_t _Found_count = 0;
+    const uint32_t _Limit = CPU_SETSIZE < _Max_cpus ? CPU_SETSIZE : _Max_cpus;
+    for (uint32_t _Cpu = 0; _Cpu < _Limit; ++_Cpu) {
+        if (!CPU_ISSET(_Cpu, _TPLMGR addressof(_Set))) { // not usable
+            continue;
+        }
+
+        const int _System_node = _Read_cpu_node(_Cpu);
+        uint32_t _Node         = 0;
+        while (_Node < _Mynode_count && _System_nodes[_Node] != _System_node) {
+            ++_Node;
+        }
+
+        if (_Node == _Mynode_count) { // a new node
+            if (_Mynode_count < _Max_numa_nodes) {
+                _System_nodes[_Mynode_count++] = _System_node;
+            } else {
+                _Node = 0;
+            }
+        }
+
+        _Mynodes[_Cpu]        = static_cast<uint8_t>(_Node);
+        _Found[_Found_count++] = static_cast<uint16_t>(_Cpu);
+        ++_Node_sizes[_Node];
+    }
+
+    _Sort_by_node(_Found, _Found_count, _Node_sizes);
+}
+#endif // _WIN32
+
+// FUNCTION _Cpu_topology::_Sort_by_node
+void _Cpu_topology::_Sort_by_node(
+    const uint16_t* const _Found, const uint32_t _Found_count, const uint32_t* const _Node_sizes) noexcept {
+    if (_Found_count == 0) { // no usable processor reported, assume the first one
+        _Mycpus[0]       = 0;
+        _Mycpu_count     = 1;
+        _Mynode_count    = 1;
+        _Mynode_begin[1] = 1;
+        return;
+    }
+
+    uint32_t _Next[_Max_numa_nodes]; // the next free position of each node
+    _Mynode_begin[0] = 0;
+    for (uint32_t _Node = 0; _Node < _Mynode_count; ++_Node) {
+        _Next[_Node]              = _Mynode_begin[_Node];
+        _Mynode_begin[_Node + 1] = _Mynode_begin[_Node] + _Node_sizes[_Node];
+    }
+
+    for (uint32_t _Idx = 0; _Idx < _Found_count; ++_Idx) { // keeps the order within each node
+        _Mycpus[_Next[_Mynodes[_Found[_Idx]]]++] = _Found[_Idx];
+    }
+
+    _Mycpu_count = _Found_count;
+}
+
+#ifdef _WIN32
+// FUNCTION _Current_cpu
+uint32_t _Current_cpu() noexcept {
+    return static_cast<uint32_t>(::GetCurrentProcessorNumber());
+}
+
+// FUNCTION _Bind_current_thread
+_NODISCARD_ATTR bool _Bind_current_thread(const uint16_t* const _Cpus, const uint32_t _Count) noexcept {
+    DWORD_PTR _Mask = 0;
+    for (uint32_t _Idx = 0; _Idx < _Count; ++_Idx) {
+        if (_Cpus[_Idx] < sizeof(DWORD_PTR) * 8) {
+            _Mask |= DWORD_PTR{1} << _Cpus[_Idx];
+        }
+    }
+
+    return _Mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), _Mask) != 0;
+}
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+// FUNCTION _Current_cpu
+uint32_t _Current_cpu() noexcept {
+    const int _Cpu = ::sched_getcpu();
+    return _Cpu >= 0 ? static_cast<uint32_t>(_Cpu) : 0;
+}
+
+// FUNCTION _Bind_current_thread
+_NODISCARD_ATTR bool _Bind_current_thread(const uint16_t* const _Cpus, const uint32_t _Count) noexcept {
+    cpu_set_t _Set;
+    CPU_ZERO(_TPLMGR addressof(_Set));
+    for (uint32_t _Idx = 0; _Idx < _Count; ++_Idx) {
+        CPU_SET(_Cpus[_Idx], _TPLMGR addressof(_Set));
+    }
+
+    return _Count > 0 && ::sched_setaffinity(0, sizeof(cpu_set_t), _TPLMGR addressof(_Set)) == 0;
+}
+#endif // _WIN32
+
+// FUNCTION _Current_numa_node
+uint32_t _Current_numa_node() noexcept {
+    return _Cpu_topology::_Get()._Node_of(_Current_cpu());
+}
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
\ No newline at end of file
@@ -0,0 +1,94 @@
+// topology.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_TOPOLOGY_HPP_
+#define _TPLMGR_TOPOLOGY_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/utils.hpp>
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <processthreadsapi.h>
+#include <winbase.h>
+#endif // _WIN32
+
+_TPLMGR_BEGIN
+// ENUM CLASS thread_affinity
+enum class thread_affinity : unsigned char {
+    none, // threads may run on any processor
+    cpu, // each thread is bound to one processor
+    numa_node // each thread is bound to the processors of one NUMA node
+};
+
+// CONSTANT _Max_cpus
+_INLINE_VARIABLE constexpr uint32_t _Max_cpus = 1024; // higher processors are ignored
+
+// CONSTANT _Max_numa_nodes
+_INLINE_VARIABLE constexpr uint32_t _Max_numa_nodes = 64; // higher nodes are treated as the first one
+
+// CONSTANT _Any_numa_node
+_INLINE_VARIABLE constexpr uint32_t _Any_numa_node = UINT32_MAX; // no node is preferred
+
+// CLASS _Cpu_topology
+class _Cpu_topology { // processors usable by the process, grouped by NUMA node
+public:
+    _Cpu_topology(const _Cpu_topology&) = delete;
+    _Cpu_topology& operator=(const _Cpu_topology&) = delete;
+
+    // returns the topology of the current process (read once)
+    static const _Cpu_topology& _Get() noexcept;
+
+    // returns the number of usable processors
+    uint32_t _Cpu_count() const noexcept;
+
+    // returns the number of NUMA nodes with at least one usable processor
+    uint32_t _Node_count() const noexcept;
+
+    // returns the node (0 to _Node_count() - 1) of the processor, 0 if unknown
+    uint32_t _Node_of(const uint32_t _Cpu) const noexcept;
+
+    // returns the number of usable processors of the node
+    uint32_t _Node_size(const uint32_t _Node) const noexcept;
+
+    // returns the processors of the node (_Node_size() of them)
+    const uint16_t* _Node_cpus(const uint32_t _Node) const noexcept;
+
+    // returns the _Idx-th processor when processors are taken from the nodes in turn
+    uint32_t _Spread_cpu(uint32_t _Idx) const noexcept;
+
+private:
+    _Cpu_topology() noexcept;
+
+    // reads the processors and their nodes (/sys/devices/system/cpu on Linux)
+    void _Read() noexcept;
+
+    // fills _Mycpus and _Mynode_begin from the found processors (_Mynodes must be set)
+    void _Sort_by_node(
+        const uint16_t* const _Found, const uint32_t _Found_count, const uint32_t* const _Node_sizes) noexcept;
+
+    // Note: Node numbers reported by the system may have gaps, they are mapped to 0..N-1.
+    //       _Mycpus holds the usable processors sorted by node, the processors of node N
+    //       are _Mycpus[_Mynode_begin[N]] to _Mycpus[_Mynode_begin[N + 1] - 1].
+    uint16_t _Mycpus[_Max_cpus];
+    uint8_t _Mynodes[_Max_cpus]; // node of each processor
+    uint32_t _Mynode_begin[_Max_numa_nodes + 1];
+    uint32_t _Mycpu_count;
+    uint32_t _Mynode_count;
+};
+
+// FUNCTION _Current_cpu
+extern uint32_t _Current_cpu() noexcept;
+
+// FUNCTION _Current_numa_node
+extern uint32_t _Current_numa_node() noexcept;
+
+// FUNCTION _Bind_current_thread
+_NODISCARD_ATTR extern bool _Bind_current_thread(const uint16_t* const _Cpus, const uint32_t _Count) noexcept;
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_TOPOLOGY_HPP_
\ No newline at end of file
@@ -7,6 +7,18 @@
 #ifndef _TPLMGR_TPLMGR_FWK_HPP_
 #define _TPLMGR_TPLMGR_FWK_HPP_
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#else // ^^^ _WIN32 ^^^ / vvv __linux__ vvv
+#include <cerrno>
+#include <climits>
+#include <dirent.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif // _WIN32
 #endif // _TPLMGR_TPLMGR_FWK_HPP_
\ No newline at end of file
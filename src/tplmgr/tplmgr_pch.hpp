@@ -11,11 +11,22 @@
 #include <tplmgr/tplmgr_fwk.hpp>
 #include <tplmgr/allocator.hpp>
 #include <tplmgr/async.hpp>
+#include <tplmgr/bounded_shared_queue.hpp>
 #include <tplmgr/core.hpp>
+#include <tplmgr/coroutine.hpp>
+#include <tplmgr/mpsc_queue.hpp>
+#include <tplmgr/parallel_for.hpp>
+#include <tplmgr/scaling_controller.hpp>
 #include <tplmgr/shared_lock.hpp>
+#include <tplmgr/shared_priority_queue.hpp>
 #include <tplmgr/shared_queue.hpp>
 #include <tplmgr/stack.hpp>
+#include <tplmgr/task_future.hpp>
+#include <tplmgr/task_graph.hpp>
 #include <tplmgr/thread.hpp>
 #include <tplmgr/thread_pool.hpp>
+#include <tplmgr/timer_wheel.hpp>
+#include <tplmgr/topology.hpp>
 #include <tplmgr/utils.hpp>
+#include <tplmgr/work_stealing_deque.hpp>
 #endif // _TPLMGR_TPLMGR_PCH_HPP_
\ No newline at end of file
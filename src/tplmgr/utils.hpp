@@ -8,8 +8,13 @@
 #define _TPLMGR_UTILS_HPP_
 #include <tplmgr/core.hpp>
 #if _TPLMGR_PREPROCESSOR_GUARD
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
+#include <utility>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
 
 _TPLMGR_BEGIN
 // STD types
@@ -40,6 +45,42 @@ constexpr
 template <class _Ty>
 const _Ty* addressof(const _Ty&&) = delete;
 
+// CONSTANT _Cache_line_size
+_INLINE_VARIABLE constexpr size_t _Cache_line_size = 64; // assumed size of a cache line
+
+// FUNCTION _Bit_scan_reverse
+inline uint32_t _Bit_scan_reverse(const uint32_t _Val) noexcept { // _Val must not be 0
+#ifdef _MSC_VER
+    unsigned long _Idx;
+    _BitScanReverse(_TPLMGR addressof(_Idx), _Val);
+    return static_cast<uint32_t>(_Idx);
+#else // ^^^ _MSC_VER ^^^ / vvv !_MSC_VER vvv
+    return 31 - static_cast<uint32_t>(__builtin_clz(_Val));
+#endif // _MSC_VER
+}
+
+// FUNCTION _Bit_scan_forward
+inline uint32_t _Bit_scan_forward(const uint32_t _Val) noexcept { // _Val must not be 0
+#ifdef _MSC_VER
+    unsigned long _Idx;
+    _BitScanForward(_TPLMGR addressof(_Idx), _Val);
+    return static_cast<uint32_t>(_Idx);
+#else // ^^^ _MSC_VER ^^^ / vvv !_MSC_VER vvv
+    return static_cast<uint32_t>(__builtin_ctz(_Val));
+#endif // _MSC_VER
+}
+
+// FUNCTION _Yield_processor
+inline void _Yield_processor() noexcept { // hints the processor that the thread is spinning
+#if defined(_MSC_VER)
+    _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__) // ^^^ _MSC_VER ^^^ / vvv x86/x64 vvv
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) // ^^^ x86/x64 ^^^ / vvv ARM64 vvv
+    __asm__ __volatile__("yield");
+#endif // defined(_MSC_VER)
+}
+
 // FUNCTION TEMPLATE exchange
 template <class _Ty, class _Other = _Ty>
 #if _HAS_CXX20_FEATURES
@@ -0,0 +1,237 @@
+// work_stealing_deque.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _TPLMGR_WORK_STEALING_DEQUE_HPP_
+#define _TPLMGR_WORK_STEALING_DEQUE_HPP_
+#include <tplmgr/core.hpp>
+#if _TPLMGR_PREPROCESSOR_GUARD
+#include <tplmgr/allocator.hpp>
+#include <tplmgr/utils.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+_TPLMGR_BEGIN
+// STD types
+using _STD atomic;
+
+// CLASS TEMPLATE _Atomic_slot
+template <class _Ty>
+class _Atomic_slot { // stores a trivially copyable value as a sequence of atomic words
+public:
+    static_assert(_STD is_trivially_copyable<_Ty>::value, "_Ty must be trivially copyable.");
+
+    // Note: A thief may read a slot while the owner overwrites it. Such a value is discarded
+    //       (the thief fails to claim it), but the access itself must not be a data race.
+    void _Store(const _Ty& _Val) noexcept {
+        uintptr_t _Words[_Word_count] = {};
+        _STD memcpy(_Words, _TPLMGR addressof(_Val), sizeof(_Ty));
+        for (size_t _Idx = 0; _Idx < _Word_count; ++_Idx) {
+            _Mywords[_Idx].store(_Words[_Idx], _STD memory_order_relaxed);
+        }
+    }
+
+    _Ty _Load() const noexcept {
+        uintptr_t _Words[_Word_count];
+        for (size_t _Idx = 0; _Idx < _Word_count; ++_Idx) {
+            _Words[_Idx] = _Mywords[_Idx].load(_STD memory_order_relaxed);
+        }
+
+        _Ty _Val;
+        _STD memcpy(_TPLMGR addressof(_Val), _Words, sizeof(_Ty));
+        return _Val;
+    }
+
+private:
+    static constexpr size_t _Word_count = (sizeof(_Ty) + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+
+    atomic<uintptr_t> _Mywords[_Word_count];
+};
+
+// STRUCT TEMPLATE _Work_stealing_buffer
+template <class _Ty>
+struct _Work_stealing_buffer { // circular array, followed by its slots
+    _Work_stealing_buffer* _Prev; // pointer to the retired (smaller) buffer
+    size_t _Mask; // capacity - 1
+
+    _Atomic_slot<_Ty>* _Slots() noexcept {
+        return reinterpret_cast<_Atomic_slot<_Ty>*>(this + 1);
+    }
+
+    _Atomic_slot<_Ty>& _At(const ptrdiff_t _Idx) noexcept {
+        return _Slots()[static_cast<size_t>(_Idx) & _Mask];
+    }
+};
+
+// CLASS TEMPLATE _Work_stealing_deque
+template <class _Ty>
+class _Work_stealing_deque { // non-throwing Chase-Lev deque
+private:
+    // Note: Only the owner may push and pop (LIFO, bottom end). Any thread may steal (FIFO, top end).
+    //       See "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., 2013).
+    using _Alloc    = allocator<void>;
+    using _Buffer_t = _Work_stealing_buffer<_Ty>;
+    using _Slot_t   = _Atomic_slot<_Ty>;
+
+    static_assert(alignof(_Slot_t) <= alignof(_Buffer_t), "slots must follow the buffer header");
+
+public:
+    using value_type      = _Ty;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+
+    static constexpr size_type _Initial_capacity = 64;
+
+    _Work_stealing_deque() noexcept : _Mytop(0), _Mybottom(0), _Mybuffer(nullptr) {}
+
+    _Work_stealing_deque(_Work_stealing_deque&& _Other) noexcept
+        : _Mytop(_Other._Mytop.exchange(0, _STD memory_order_relaxed)),
+        _Mybottom(_Other._Mybottom.exchange(0, _STD memory_order_relaxed)),
+        _Mybuffer(_Other._Mybuffer.exchange(nullptr, _STD memory_order_relaxed)) {}
+
+    ~_Work_stealing_deque() noexcept {
+        _Free_buffers(_Mybuffer.load(_STD memory_order_relaxed));
+    }
+
+    _Work_stealing_deque& operator=(_Work_stealing_deque&& _Other) noexcept {
+        if (this != _TPLMGR addressof(_Other)) {
+            _Free_buffers(_Mybuffer.load(_STD memory_order_relaxed));
+            _Mytop.store(_Other._Mytop.exchange(0, _STD memory_order_relaxed), _STD memory_order_relaxed);
+            _Mybottom.store(
+                _Other._Mybottom.exchange(0, _STD memory_order_relaxed), _STD memory_order_relaxed);
+            _Mybuffer.store(
+                _Other._Mybuffer.exchange(nullptr, _STD memory_order_relaxed), _STD memory_order_relaxed);
+        }
+
+        return *this;
+    }
+
+    _Work_stealing_deque(const _Work_stealing_deque&) = delete;
+    _Work_stealing_deque& operator=(const _Work_stealing_deque&) = delete;
+
+    bool _Empty() const noexcept {
+        return _Size() == 0;
+    }
+
+    size_type _Size() const noexcept { // approximate if called concurrently
+        const ptrdiff_t _Bottom = _Mybottom.load(_STD memory_order_relaxed);
+        const ptrdiff_t _Top    = _Mytop.load(_STD memory_order_relaxed);
+        return _Bottom > _Top ? static_cast<size_type>(_Bottom - _Top) : 0;
+    }
+
+    _NODISCARD_ATTR bool _Reserve(const size_type _Count) noexcept { // owner only
+        const ptrdiff_t _Bottom = _Mybottom.load(_STD memory_order_relaxed);
+        const ptrdiff_t _Top    = _Mytop.load(_STD memory_order_acquire);
+        _Buffer_t* _Buffer      = _Mybuffer.load(_STD memory_order_relaxed);
+        const size_type _Needed = static_cast<size_type>(_Bottom - _Top) + _Count;
+        if (_Buffer && _Needed <= _Buffer->_Mask + 1) { // enough space
+            return true;
+        }
+
+        size_type _Capacity = _Buffer ? (_Buffer->_Mask + 1) * 2 : _Initial_capacity;
+        while (_Capacity < _Needed) {
+            _Capacity *= 2;
+        }
+
+        return _Grow(_Buffer, _Capacity, _Top, _Bottom) != nullptr;
+    }
+
+    _NODISCARD_ATTR bool _Push(const _Ty& _Val) noexcept { // owner only
+        const ptrdiff_t _Bottom = _Mybottom.load(_STD memory_order_relaxed);
+        const ptrdiff_t _Top    = _Mytop.load(_STD memory_order_acquire);
+        _Buffer_t* _Buffer      = _Mybuffer.load(_STD memory_order_relaxed);
+        if (!_Buffer || static_cast<size_type>(_Bottom - _Top) > _Buffer->_Mask) { // full, grow
+            _Buffer = _Grow(_Buffer, _Buffer ? (_Buffer->_Mask + 1) * 2 : _Initial_capacity, _Top, _Bottom);
+            if (!_Buffer) { // allocation failed
+                return false;
+            }
+        }
+
+        _Buffer->_At(_Bottom)._Store(_Val);
+        _Mybottom.store(_Bottom + 1, _STD memory_order_release); // publish the task and its data
+        return true;
+    }
+
+    _NODISCARD_ATTR bool _Pop(_Ty& _Val) noexcept { // owner only
+        const ptrdiff_t _Bottom = _Mybottom.load(_STD memory_order_relaxed) - 1;
+        _Buffer_t* const _Buffer = _Mybuffer.load(_STD memory_order_relaxed);
+        _Mybottom.store(_Bottom, _STD memory_order_relaxed);
+        _STD atomic_thread_fence(_STD memory_order_seq_cst);
+        ptrdiff_t _Top = _Mytop.load(_STD memory_order_relaxed);
+        if (_Top > _Bottom) { // empty, restore the bottom
+            _Mybottom.store(_Bottom + 1, _STD memory_order_relaxed);
+            return false;
+        }
+
+        _Val = _Buffer->_At(_Bottom)._Load();
+        if (_Top == _Bottom) { // the last element, race against thieves
+            const bool _Won = _Mytop.compare_exchange_strong(
+                _Top, _Top + 1, _STD memory_order_seq_cst, _STD memory_order_relaxed);
+            _Mybottom.store(_Bottom + 1, _STD memory_order_relaxed);
+            return _Won;
+        }
+
+        return true;
+    }
+
+    _NODISCARD_ATTR bool _Steal(_Ty& _Val) noexcept { // any thread
+        ptrdiff_t _Top = _Mytop.load(_STD memory_order_acquire);
+        _STD atomic_thread_fence(_STD memory_order_seq_cst);
+        const ptrdiff_t _Bottom = _Mybottom.load(_STD memory_order_acquire);
+        if (_Top >= _Bottom) { // empty
+            return false;
+        }
+
+        _Buffer_t* const _Buffer = _Mybuffer.load(_STD memory_order_acquire);
+        _Val                     = _Buffer->_At(_Top)._Load();
+        return _Mytop.compare_exchange_strong(
+            _Top, _Top + 1, _STD memory_order_seq_cst, _STD memory_order_relaxed); // lost the race if false
+    }
+
+private:
+    _Buffer_t* _Grow(_Buffer_t* const _Old, const size_type _Capacity,
+        const ptrdiff_t _Top, const ptrdiff_t _Bottom) noexcept { // owner only
+        _Alloc _Al;
+        void* const _Raw = _Al.allocate(sizeof(_Buffer_t) + _Capacity * sizeof(_Slot_t));
+        if (!_Raw) { // allocation failed
+            return nullptr;
+        }
+
+        _Buffer_t* const _New = ::new (_Raw) _Buffer_t;
+        _New->_Prev           = _Old; // thieves may still read the old buffer, free it later
+        _New->_Mask           = _Capacity - 1;
+        for (size_type _Idx = 0; _Idx < _Capacity; ++_Idx) {
+            ::new (static_cast<void*>(_New->_Slots() + _Idx)) _Slot_t;
+        }
+
+        for (ptrdiff_t _Idx = _Top; _Idx < _Bottom; ++_Idx) {
+            _New->_At(_Idx)._Store(_Old->_At(_Idx)._Load());
+        }
+
+        _Mybuffer.store(_New, _STD memory_order_release);
+        return _New;
+    }
+
+    static void _Free_buffers(_Buffer_t* _Buffer) noexcept {
+        _Alloc _Al;
+        _Buffer_t* _Prev;
+        for (; _Buffer != nullptr; _Buffer = _Prev) {
+            _Prev = _Buffer->_Prev;
+            _Al.deallocate(_Buffer, sizeof(_Buffer_t) + (_Buffer->_Mask + 1) * sizeof(_Slot_t));
+        }
+    }
+
+    atomic<ptrdiff_t> _Mytop; // next element to steal
+    char _Mypad[_Cache_line_size - sizeof(atomic<ptrdiff_t>)]; // keep thieves off the owner's line
+    atomic<ptrdiff_t> _Mybottom; // next free slot
+    atomic<_Buffer_t*> _Mybuffer;
+};
+_TPLMGR_END
+
+#endif // _TPLMGR_PREPROCESSOR_GUARD
+#endif // _TPLMGR_WORK_STEALING_DEQUE_HPP_
\ No newline at end of file